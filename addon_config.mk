@@ -34,6 +34,8 @@ common:
 	# any special flag that should be passed to the compiler when using this
 	# addon 
 	#  ADDON_CFLAGS
+	# add -DOFX_ASSETS_ARENA for AssetHolder::setArenaAllocation() (needs <memory_resource>, C++17)
+	#  ADDON_CFLAGS += -DOFX_ASSETS_ARENA
 	
 	# any special flag that should be passed to the linker when using this
 	# addon, also used for system libraries with -lname
@@ -0,0 +1,137 @@
+//
+//  main.cpp
+//  ofxAssets - example-cli
+//
+//  Headless asset verifier: reads a manifest, checks all the assets in parallel, optionally
+//  downloads / repairs whatever is missing, and prints JSON stats to stdout.
+//  Exit code is 0 if all assets are ready to use, 1 if some are not, 2 on bad usage / manifest.
+//
+//  See AssetManifestLoader.h for the manifest format; it is streamed, and checking starts while
+//  it is still being parsed.
+//
+
+#include "ofMain.h"
+#include "ofxAssets.h"
+
+static void printUsage(){
+	cerr << "usage: example-cli <manifest.json> [--threads N] [--assetsPerHolder N] [--download] [--repair] "
+			"[--dataPath dir] [--verbose]" << endl;
+}
+
+
+static double secondsSince(const std::chrono::steady_clock::time_point & t){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+
+int main(int argc, char ** argv){
+
+	string manifestPath;
+	int numThreads = std::thread::hardware_concurrency();
+	int assetsPerHolder = 32; //holders are checked in parallel, the assets of one holder are not
+	bool download = false;
+	bool repair = false;
+	bool verbose = false;
+
+	for(int i = 1; i < argc; i++){
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(arg == "--threads" && hasValue) numThreads = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--assetsPerHolder" && hasValue) assetsPerHolder = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--dataPath" && hasValue) ofSetDataPathRoot(argv[++i]);
+		else if(arg == "--download") download = true;
+		else if(arg == "--repair") repair = true;
+		else if(arg == "--verbose") verbose = true;
+		else if(arg.size() && arg[0] != '-' && manifestPath.empty()) manifestPath = arg;
+		else{ printUsage(); return 2; }
+	}
+	if(manifestPath.empty()){ printUsage(); return 2; }
+	manifestPath = std::filesystem::absolute(manifestPath).string(); //relative to cwd, not to data
+
+	//stdout is for the JSON report only
+	ofSetLogLevel(verbose ? OF_LOG_NOTICE : OF_LOG_SILENT);
+
+	// Load & Check //
+	AssetManifestLoader loader;
+	loader.setup("downloads", ofxAssets::UsagePolicy(), ofxAssets::DownloadPolicy(), assetsPerHolder);
+	AssetChecker checker;
+	checker.setRepairCorruptChunks(repair);
+	vector<AssetHolder*> holders;
+
+	auto checkStart = std::chrono::steady_clock::now();
+	auto check = loader.loadAndCheck(manifestPath, checker, holders, numThreads);
+	check->wait();
+	uint64_t bytesChecked = check->getCounters().numBytes;
+	uint64_t filesChecked = check->getCounters().numFiles;
+	double checkSeconds = secondsSince(checkStart); //includes parsing the manifest
+
+	if(loader.getError().size() || holders.empty()){
+		cerr << (loader.getError().size() ? loader.getError() : "manifest \"" + manifestPath + "\" has no assets") << endl;
+		check.reset();
+		for(auto h : holders) delete h;
+		return 2;
+	}
+
+	// Download //
+	ofJson downloadReport;
+	if(download){
+		AssetResumableDownloader downloader;
+		auto downloadStart = std::chrono::steady_clock::now();
+		size_t numRequested = 0;
+		for(auto h : holders){
+			numRequested += h->downloadMissingAssets(downloader).size();
+		}
+		while(downloader.isBusy()){
+			downloader.update(); //delivers the reports to each AssetHolder
+			ofSleepMillis(50);
+		}
+		downloader.update();
+		downloadReport["numRequested"] = numRequested;
+		downloadReport["seconds"] = secondsSince(downloadStart);
+	}
+
+	// Report //
+	ofxAssets::Stats total;
+	ofJson broken = ofJson::array();
+	int numAssets = 0;
+	for(auto h : holders){
+		ofxAssets::Stats s = h->getAssetStats();
+		total.numMissingFile += s.numMissingFile;
+		total.numChecksumMissmatch += s.numChecksumMissmatch;
+		total.numFileTooSmall += s.numFileTooSmall;
+		total.numOK += s.numOK;
+		total.numDownloadFailed += s.numDownloadFailed;
+		total.numNoChecksumSupplied += s.numNoChecksumSupplied;
+		numAssets += s.numAssets;
+		for(auto & d : h->getBrokenAssets()){
+			broken.push_back(d.relativePath);
+		}
+	}
+
+	ofJson report;
+	report["manifest"] = manifestPath;
+	report["numAssets"] = numAssets;
+	report["numBadEntries"] = loader.getNumBadEntries();
+	report["numHolders"] = holders.size();
+	report["numThreads"] = numThreads;
+	report["numOK"] = total.numOK;
+	report["numMissingFile"] = total.numMissingFile;
+	report["numChecksumMismatch"] = total.numChecksumMissmatch;
+	report["numFileTooSmall"] = total.numFileTooSmall;
+	report["numNoChecksumSupplied"] = total.numNoChecksumSupplied;
+	report["numDownloadFailed"] = total.numDownloadFailed;
+	report["numBroken"] = broken.size();
+	report["broken"] = broken;
+	report["check"]["seconds"] = checkSeconds;
+	report["check"]["filesChecked"] = filesChecked;
+	report["check"]["bytesChecked"] = bytesChecked;
+	report["check"]["filesPerSecond"] = checkSeconds > 0 ? filesChecked / checkSeconds : 0;
+	report["check"]["MBPerSecond"] = checkSeconds > 0 ? bytesChecked / (1024.0 * 1024.0) / checkSeconds : 0;
+	if(download) report["download"] = downloadReport;
+
+	cout << report.dump(4) << endl;
+
+	check.reset();
+	for(auto h : holders) delete h;
+	return broken.empty() ? 0 : 1;
+}
@@ -0,0 +1,228 @@
+//
+//  SyntheticAssetServer.cpp
+//  ofxAssets - example-downloadBenchmark
+//
+//
+
+#include "SyntheticAssetServer.h"
+#include "AssetHasher.h"
+#include "Poco/Net/HTTPServer.h"
+#include "Poco/Net/HTTPRequestHandler.h"
+#include "Poco/Net/HTTPRequestHandlerFactory.h"
+#include "Poco/Net/HTTPServerParams.h"
+#include "Poco/Net/HTTPServerRequest.h"
+#include "Poco/Net/HTTPServerResponse.h"
+#include "Poco/Net/ServerSocket.h"
+
+using namespace Poco::Net;
+
+class SyntheticAssetHandler : public HTTPRequestHandler{
+
+public:
+
+	SyntheticAssetHandler(SyntheticAssetServer * server_) : server(server_){}
+
+	void handleRequest(HTTPServerRequest & request, HTTPServerResponse & response){
+
+		server->numRequests++;
+		if(server->settings.latencyMs > 0){
+			ofSleepMillis(server->settings.latencyMs);
+		}
+
+		//  /redirect/<hops>/asset/<index>.<ext> >> 302 to one hop less, then to /asset/<index>.<ext>
+		string uri = request.getURI();
+		int hops = 0;
+		if(uri.find("/redirect/") == 0 && sscanf(uri.c_str(), "/redirect/%d/", &hops) == 1){
+			size_t rest = uri.find('/', strlen("/redirect/"));
+			string next = hops > 1 ? "/redirect/" + ofToString(hops - 1) + uri.substr(rest) : uri.substr(rest);
+			response.set("Location", next); //relative, like lots of CDNs do
+			response.setStatusAndReason(HTTPResponse::HTTP_FOUND);
+			response.send();
+			return;
+		}
+
+		//  /shifted/asset/<index>.<ext> >> a broken server, answers Range requests from byte 0
+		bool shifted = uri.find("/shifted/") == 0;
+		if(shifted) uri = uri.substr(strlen("/shifted"));
+
+		//  /asset/<index>.<ext>
+		size_t index = 0;
+		if(uri.find("/asset/") != 0 || sscanf(uri.c_str(), "/asset/%zu", &index) != 1){
+			response.setStatusAndReason(HTTPResponse::HTTP_NOT_FOUND);
+			response.send();
+			return;
+		}
+
+		SyntheticAssetServer::AssetInfo info = server->getAssetInfo(index);
+		if(info.fails){
+			response.setStatusAndReason(HTTPResponse::HTTP_INTERNAL_SERVER_ERROR);
+			response.send();
+			return;
+		}
+
+		uint64_t offset = 0;
+		uint64_t end = info.size; //exclusive
+		if(request.has("Range")){
+			unsigned long long from = 0, to = 0;
+			int n = sscanf(request.get("Range").c_str(), "bytes=%llu-%llu", &from, &to);
+			if(n >= 1 && from < info.size && (n == 1 || to >= from)){
+				if(n == 2) end = std::min<uint64_t>(info.size, to + 1);
+				if(shifted){
+					end -= from;
+					from = 0;
+				}
+				offset = from;
+				response.setStatusAndReason(HTTPResponse::HTTP_PARTIAL_CONTENT);
+				response.set("Content-Range", "bytes " + ofToString(offset) + "-" + ofToString(end - 1) + "/" + ofToString(info.size));
+			}else{
+				response.set("Content-Range", "bytes */" + ofToString(info.size));
+				response.setStatusAndReason(HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE);
+				response.send();
+				return;
+			}
+		}
+
+		response.setContentType("application/octet-stream");
+		response.setContentLength64(end - offset);
+		std::ostream & out = response.send();
+
+		vector<char> block(64 * 1024);
+		while(offset < end && out){
+			size_t n = (size_t)std::min<uint64_t>(block.size(), end - offset);
+			server->fill(index, offset, block.data(), n, info.corrupt);
+			server->limiter.consume(n);
+			out.write(block.data(), n);
+			offset += n;
+			server->numBytesServed += n;
+		}
+	}
+
+protected:
+
+	SyntheticAssetServer * server;
+};
+
+
+class SyntheticAssetHandlerFactory : public HTTPRequestHandlerFactory{
+
+public:
+
+	SyntheticAssetHandlerFactory(SyntheticAssetServer * server_) : server(server_){}
+
+	HTTPRequestHandler * createRequestHandler(const HTTPServerRequest &){
+		return new SyntheticAssetHandler(server);
+	}
+
+protected:
+
+	SyntheticAssetServer * server;
+};
+
+
+SyntheticAssetServer::~SyntheticAssetServer(){
+	stop();
+}
+
+
+bool SyntheticAssetServer::start(const Settings & settings_){
+
+	stop();
+	settings = settings_;
+	limiter.setMaxBytesPerSecond(settings.bytesPerSecond);
+
+	try{
+		HTTPServerParams::Ptr params = new HTTPServerParams();
+		params->setMaxThreads(settings.maxThreads);
+		params->setMaxQueued(1024);
+		server = new HTTPServer(new SyntheticAssetHandlerFactory(this), ServerSocket(settings.port), params);
+		server->start();
+	}catch(Poco::Exception & e){
+		ofLogError("SyntheticAssetServer") << "Can't start server on port " << settings.port << ": " << e.displayText();
+		server = nullptr;
+		return false;
+	}
+	return true;
+}
+
+
+void SyntheticAssetServer::stop(){
+	if(server){
+		server->stopAll(true);
+		delete server;
+		server = nullptr;
+	}
+}
+
+
+uint64_t SyntheticAssetServer::hash(uint64_t a, uint64_t b) const{ //splitmix64 of the pair
+	uint64_t z = settings.seed * 0x9E3779B97F4A7C15ULL + a * 0xBF58476D1CE4E5B9ULL + b;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+
+SyntheticAssetServer::AssetInfo SyntheticAssetServer::getAssetInfo(size_t index) const{
+
+	static const char * extensions[] = {"jpg", "png", "json", "mov", "wav"};
+	auto uniform = [&](uint64_t salt){ return (hash(index, salt) >> 11) * (1.0 / 9007199254740992.0); }; //0..1
+
+	AssetInfo info;
+	info.extension = extensions[hash(index, 1) % 5];
+	info.fails = uniform(2) < settings.failureRate;
+	info.corrupt = !info.fails && uniform(3) < settings.corruptionRate;
+	info.tiny = uniform(4) < settings.tinyRate;
+	if(info.tiny){
+		info.size = 1 + hash(index, 5) % 512;
+	}else{ //log-uniform, lots of small ones and a few big ones
+		double lmin = log((double)settings.minSize);
+		double lmax = log((double)std::max(settings.minSize, settings.maxSize));
+		info.size = (uint64_t)exp(lmin + uniform(6) * (lmax - lmin));
+	}
+	return info;
+}
+
+
+string SyntheticAssetServer::getURL(size_t index) const{
+	return "http://127.0.0.1:" + ofToString(settings.port) + "/asset/" + ofToString(index) + "." + getAssetInfo(index).extension;
+}
+
+
+string SyntheticAssetServer::getRedirectURL(size_t index, int hops) const{
+	return "http://127.0.0.1:" + ofToString(settings.port) + "/redirect/" + ofToString(hops) + "/asset/" +
+			ofToString(index) + "." + getAssetInfo(index).extension;
+}
+
+
+string SyntheticAssetServer::getShiftedURL(size_t index) const{
+	return "http://127.0.0.1:" + ofToString(settings.port) + "/shifted/asset/" + ofToString(index) + "." + getAssetInfo(index).extension;
+}
+
+
+void SyntheticAssetServer::fill(size_t index, uint64_t offset, char * buffer, size_t len, bool corrupt) const{
+
+	for(size_t i = 0; i < len; i++){
+		uint64_t p = offset + i;
+		buffer[i] = (char)(hash(index, 1000 + p / 8) >> (8 * (p % 8)));
+	}
+	if(corrupt){ //flip one byte in the middle
+		uint64_t bad = getAssetInfo(index).size / 2;
+		if(bad >= offset && bad < offset + len){
+			buffer[bad - offset] ^= 0xFF;
+		}
+	}
+}
+
+
+string SyntheticAssetServer::getChecksum(size_t index, ofxChecksum::Type type) const{
+
+	uint64_t size = getAssetInfo(index).size;
+	ofxAssets::Hasher hasher(type);
+	vector<char> block(64 * 1024);
+	for(uint64_t offset = 0; offset < size; offset += block.size()){
+		size_t n = (size_t)std::min<uint64_t>(block.size(), size - offset);
+		fill(index, offset, block.data(), n, false);
+		hasher.update(block.data(), n);
+	}
+	return hasher.getHexDigest();
+}
@@ -0,0 +1,72 @@
+//
+//  SyntheticAssetServer.h
+//  ofxAssets - example-downloadBenchmark
+//
+//  Local HTTP stand-in for an asset server. Serves /asset/<index>.<ext>, with made up (but
+//  deterministic) content, so we know the expected checksum of every asset without storing any.
+//  Latency, bandwidth, failures (HTTP 500) and corrupt payloads can be injected; which assets fail
+//  or get corrupted is decided by their index, so the client side knows what to expect.
+//  Supports "Range: bytes=N-" and "bytes=N-M" for AssetResumableDownloader and chunk repair, and
+//  serves each asset through redirects and through a broken Range implementation too.
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxChecksum.h"
+#include "AssetBandwidthLimiter.h"
+
+namespace Poco{ namespace Net{ class HTTPServer; } }
+
+class SyntheticAssetServer{
+
+public:
+
+	struct Settings{
+		int port = 8765;
+		float latencyMs = 0; //before each response
+		uint64_t bytesPerSecond = 0; //total, for all connections. 0 for no limit
+		float failureRate = 0; //0..1, these answer HTTP 500
+		float corruptionRate = 0; //0..1, these get one byte flipped
+		float tinyRate = 0.05; //0..1, these are smaller than AssetHolder's minimum file size
+		uint64_t minSize = 16 * 1024;
+		uint64_t maxSize = 4 * 1024 * 1024;
+		uint64_t seed = 1;
+		int maxThreads = 32;
+	};
+
+	struct AssetInfo{
+		uint64_t size;
+		bool fails;
+		bool corrupt;
+		bool tiny;
+		string extension;
+	};
+
+	~SyntheticAssetServer();
+
+	bool start(const Settings & settings);
+	void stop();
+
+	AssetInfo getAssetInfo(size_t index) const;
+	string getURL(size_t index) const;
+	string getRedirectURL(size_t index, int hops) const; //same asset, after that many 302s
+	string getShiftedURL(size_t index) const; //same asset, but Range requests are answered from byte 0
+	string getChecksum(size_t index, ofxChecksum::Type type) const; //of the good content
+	void fill(size_t index, uint64_t offset, char * buffer, size_t len, bool corrupt) const;
+
+	uint64_t getNumBytesServed(){return numBytesServed;}
+	uint64_t getNumRequests(){return numRequests;}
+
+protected:
+
+	friend class SyntheticAssetHandler;
+
+	uint64_t hash(uint64_t a, uint64_t b) const;
+
+	Settings settings;
+	Poco::Net::HTTPServer * server = nullptr;
+	ofxAssets::BandwidthLimiter limiter;
+	std::atomic<uint64_t> numBytesServed{0};
+	std::atomic<uint64_t> numRequests{0};
+};
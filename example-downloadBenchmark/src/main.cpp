@@ -0,0 +1,266 @@
+//
+//  main.cpp
+//  ofxAssets - example-downloadBenchmark
+//
+//  Headless benchmark / correctness harness for the download path: serves thousands of synthetic
+//  assets from a local SyntheticAssetServer, downloads them all with the chosen downloader, and
+//  checks that every asset ends up with the status it should (downloaded, downloadOK,
+//  checksumMatch, fileTooSmall), both as reported by downloadsFinished() and after re-checking
+//  the files on disk. Prints a JSON report to stdout; exit code 1 if any status is wrong.
+//  With --repair, it checks chunk repair (HTTP Range) instead: direct, through redirects, and
+//  against a server that answers the wrong range, which must be refused.
+//
+
+#include "ofMain.h"
+#include "ofxAssets.h"
+#include "SyntheticAssetServer.h"
+
+static void printUsage(){
+	cerr << "usage: example-downloadBenchmark [--assets N] [--assetsPerHolder N] [--downloader central|resumable|scheduler]\n"
+			"       [--concurrency N] [--latencyMs F] [--bandwidthMBps F] [--failures 0..1] [--corruption 0..1]\n"
+			"       [--tiny 0..1] [--maxSizeKB N] [--checksum sha1|xxhash] [--port N] [--verbose] [--repair]" << endl;
+}
+
+
+static double secondsSince(const std::chrono::steady_clock::time_point & t){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+
+//local copy of an asset with a few chunks corrupted, repaired through url. Returns what happened.
+static ofJson runRepairCase(SyntheticAssetServer & server, size_t index, const string & name, const string & url,
+							bool shouldRepair, ofxChecksum::Type checksumType, const string & dir){
+
+	const uint64_t chunkSize = 16 * 1024;
+	SyntheticAssetServer::AssetInfo info = server.getAssetInfo(index);
+
+	AssetHolder holder;
+	holder.setup(dir + "/" + name, ofxAssets::UsagePolicy(), ofxAssets::DownloadPolicy());
+	string relPath = holder.addRemoteAsset(url, server.getChecksum(index, checksumType), checksumType);
+
+	ofxAssets::ChunkManifest & chunks = holder.getAssetDescForPath(relPath).chunks;
+	chunks.fileSize = info.size;
+	chunks.chunkSize = chunkSize;
+	vector<char> content(info.size);
+	server.fill(index, 0, content.data(), content.size(), false);
+	for(size_t i = 0; i < chunks.getNumChunks(); i++){
+		chunks.chunkChecksums.push_back(ofxAssets::Hasher::hashBuffer(content.data() + chunks.getChunkOffset(i),
+																	   chunks.getChunkLength(i), checksumType));
+	}
+
+	//never chunk 0, a server that ignores the range start would get that one right by accident
+	vector<size_t> badChunks = {1, chunks.getNumChunks() - 2};
+	for(auto c : badChunks) content[chunks.getChunkOffset(c) + 7] ^= 0xFF;
+	ofBuffer corrupt(content.data(), content.size());
+	ofBufferToFile(relPath, corrupt, true);
+
+	holder.updateLocalAssetsStatus();
+	size_t numCorruptFound = holder.getAssetDescForPath(relPath).status.corruptChunks.size();
+	vector<string> repaired = holder.repairCorruptChunks();
+	bool ready = holder.isAssetReadyToUse(relPath);
+
+	ofJson j;
+	j["url"] = url;
+	j["numChunks"] = chunks.getNumChunks();
+	j["numCorruptFound"] = numCorruptFound;
+	j["repaired"] = repaired.size() == 1;
+	j["readyToUse"] = ready;
+	j["ok"] = numCorruptFound == badChunks.size() && (repaired.size() == 1) == shouldRepair && ready == shouldRepair;
+	return j;
+}
+
+
+int main(int argc, char ** argv){
+
+	SyntheticAssetServer::Settings serverSettings;
+	size_t numAssets = 2000;
+	int assetsPerHolder = 50;
+	int concurrency = 8;
+	string downloaderName = "resumable";
+	ofxChecksum::Type checksumType = ofxChecksum::Type::SHA1;
+	bool verbose = false;
+	bool repair = false;
+
+	for(int i = 1; i < argc; i++){
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(arg == "--assets" && hasValue) numAssets = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--assetsPerHolder" && hasValue) assetsPerHolder = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--downloader" && hasValue) downloaderName = argv[++i];
+		else if(arg == "--concurrency" && hasValue) concurrency = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--latencyMs" && hasValue) serverSettings.latencyMs = ofToFloat(argv[++i]);
+		else if(arg == "--bandwidthMBps" && hasValue) serverSettings.bytesPerSecond = ofToFloat(argv[++i]) * 1024 * 1024;
+		else if(arg == "--failures" && hasValue) serverSettings.failureRate = ofToFloat(argv[++i]);
+		else if(arg == "--corruption" && hasValue) serverSettings.corruptionRate = ofToFloat(argv[++i]);
+		else if(arg == "--tiny" && hasValue) serverSettings.tinyRate = ofToFloat(argv[++i]);
+		else if(arg == "--maxSizeKB" && hasValue) serverSettings.maxSize = ofToInt64(argv[++i]) * 1024;
+		else if(arg == "--checksum" && hasValue) checksumType = string(argv[++i]) == "sha1" ? ofxChecksum::Type::SHA1 : ofxChecksum::Type::XX_HASH;
+		else if(arg == "--port" && hasValue) serverSettings.port = ofToInt(argv[++i]);
+		else if(arg == "--verbose") verbose = true;
+		else if(arg == "--repair") repair = true;
+		else{ printUsage(); return 2; }
+	}
+	if(downloaderName != "central" && downloaderName != "resumable" && downloaderName != "scheduler"){
+		printUsage();
+		return 2;
+	}
+
+	ofSetLogLevel(verbose ? OF_LOG_NOTICE : OF_LOG_SILENT); //stdout is for the JSON report only
+
+	SyntheticAssetServer server;
+	serverSettings.maxThreads = std::max(serverSettings.maxThreads, concurrency * 2);
+	if(!server.start(serverSettings)){
+		cerr << "can't start the server on port " << serverSettings.port << endl;
+		return 2;
+	}
+
+	//start from an empty download folder every time
+	string downloadDir = "downloadBenchmark";
+	ofDirectory::removeDirectory(downloadDir, true);
+
+	if(repair){ // Chunk repair //
+		size_t index = 0; //first good asset with a few chunks to it
+		while(true){
+			SyntheticAssetServer::AssetInfo info = server.getAssetInfo(index);
+			if(!info.fails && !info.corrupt && !info.tiny && info.size >= 8 * 16 * 1024) break;
+			index++;
+		}
+		ofJson report;
+		report["index"] = index;
+		report["cases"].push_back(runRepairCase(server, index, "direct", server.getURL(index), true, checksumType, downloadDir));
+		report["cases"].push_back(runRepairCase(server, index, "redirect", server.getRedirectURL(index, 3), true, checksumType, downloadDir));
+		report["cases"].push_back(runRepairCase(server, index, "shifted", server.getShiftedURL(index), false, checksumType, downloadDir));
+		bool allOK = true;
+		for(auto & c : report["cases"]) allOK = allOK && c["ok"].get<bool>();
+		report["ok"] = allOK;
+		cout << report.dump(4) << endl;
+		server.stop();
+		return allOK ? 0 : 1;
+	}
+
+	// Setup //
+	vector<AssetHolder*> holders;
+	vector<std::pair<AssetHolder*, size_t>> assetOwners; //holder, asset index; by asset index
+	for(size_t i = 0; i < numAssets; i++){
+		if(holders.empty() || holders.back()->getNumAssets() >= assetsPerHolder){
+			AssetHolder * h = new AssetHolder();
+			h->setup(downloadDir, ofxAssets::UsagePolicy(), ofxAssets::DownloadPolicy());
+			holders.push_back(h);
+		}
+		holders.back()->addRemoteAsset(server.getURL(i), server.getChecksum(i, checksumType), checksumType);
+		assetOwners.push_back(std::make_pair(holders.back(), i));
+	}
+	for(auto h : holders){
+		h->updateLocalAssetsStatus(); //all missing, but they must be checked before downloading
+	}
+
+	// Download //
+	ofxDownloadCentral central;
+	AssetResumableDownloader resumable;
+	AssetDownloadScheduler scheduler;
+	std::function<void()> update;
+	std::function<bool()> isBusy;
+
+	auto start = std::chrono::steady_clock::now();
+	if(downloaderName == "central"){
+		central.setMaxConcurrentDownloads(concurrency);
+		central.setChecksumType(checksumType);
+		for(auto h : holders) h->downloadMissingAssets(central);
+		update = [&](){ central.update(); };
+		isBusy = [&](){ return central.isBusy(); };
+	}else if(downloaderName == "resumable"){ //one thread, holders are queued one after the other
+		for(auto h : holders) h->downloadMissingAssets(resumable);
+		update = [&](){ resumable.update(); };
+		isBusy = [&](){ return resumable.isBusy(); };
+	}else{
+		scheduler.setup(concurrency);
+		for(auto h : holders) scheduler.requestMissingAssets(h);
+		update = [&](){ scheduler.update(); };
+		isBusy = [&](){ return scheduler.isBusy(); };
+	}
+	while(isBusy()){
+		update();
+		ofSleepMillis(5);
+	}
+	update();
+	double seconds = secondsSince(start);
+
+	// Verify //
+	size_t numReported = 0, numWrongReported = 0, numWrongOnDisk = 0;
+	size_t numExpectedOK = 0, numFailInjected = 0, numCorruptInjected = 0, numTiny = 0;
+	uint64_t numBytesExpected = 0;
+	ofJson wrong = ofJson::array();
+
+	for(auto & it : assetOwners){
+		AssetHolder * h = it.first;
+		SyntheticAssetServer::AssetInfo info = server.getAssetInfo(it.second);
+		ofxAssets::Descriptor & d = h->getAssetDescForURL(server.getURL(it.second));
+		const ofxAssets::LocalAssetStatus & s = d.status;
+
+		bool good = !info.fails && !info.corrupt;
+		numExpectedOK += good ? 1 : 0;
+		numFailInjected += info.fails ? 1 : 0;
+		numCorruptInjected += info.corrupt ? 1 : 0;
+		numTiny += info.tiny ? 1 : 0;
+		if(good) numBytesExpected += info.size;
+		if(s.downloaded) numReported++;
+
+		bool ok;
+		if(info.fails){
+			ok = s.downloaded && !s.downloadOK && !s.checksumMatch;
+		}else if(info.corrupt){
+			ok = s.downloaded && !s.checksumMatch;
+		}else{
+			ok = s.downloaded && s.downloadOK && s.checksumMatch && s.fileTooSmall == info.tiny;
+		}
+		if(!ok){
+			numWrongReported++;
+			if(wrong.size() < 20){
+				ofJson w;
+				w["url"] = d.url;
+				w["fails"] = info.fails; w["corrupt"] = info.corrupt; w["tiny"] = info.tiny;
+				w["downloaded"] = s.downloaded; w["downloadOK"] = s.downloadOK;
+				w["checksumMatch"] = s.checksumMatch; w["fileTooSmall"] = s.fileTooSmall;
+				wrong.push_back(w);
+			}
+		}
+	}
+
+	//and what's actually on disk agrees?
+	for(auto h : holders) h->updateLocalAssetsStatus();
+	for(auto & it : assetOwners){
+		SyntheticAssetServer::AssetInfo info = server.getAssetInfo(it.second);
+		bool shouldBeReady = !info.fails && !info.corrupt; //tiny files are fine if their checksum matches
+		string relPath = it.first->getAssetDescForURL(server.getURL(it.second)).relativePath;
+		if(it.first->isAssetReadyToUse(relPath) != shouldBeReady){
+			numWrongOnDisk++;
+		}
+	}
+
+	ofJson report;
+	report["downloader"] = downloaderName;
+	report["numAssets"] = numAssets;
+	report["numHolders"] = holders.size();
+	report["concurrency"] = downloaderName == "resumable" ? 1 : concurrency;
+	report["injected"]["latencyMs"] = serverSettings.latencyMs;
+	report["injected"]["bandwidthBytesPerSecond"] = serverSettings.bytesPerSecond;
+	report["injected"]["failures"] = numFailInjected;
+	report["injected"]["corrupt"] = numCorruptInjected;
+	report["injected"]["tiny"] = numTiny;
+	report["seconds"] = seconds;
+	report["numRequests"] = server.getNumRequests();
+	report["bytesServed"] = server.getNumBytesServed();
+	report["assetsPerSecond"] = seconds > 0 ? numAssets / seconds : 0;
+	report["MBPerSecond"] = seconds > 0 ? server.getNumBytesServed() / (1024.0 * 1024.0) / seconds : 0;
+	report["goodBytesExpected"] = numBytesExpected;
+	report["numExpectedOK"] = numExpectedOK;
+	report["numReported"] = numReported;
+	report["numWrongReportedStatus"] = numWrongReported;
+	report["numWrongOnDiskStatus"] = numWrongOnDisk;
+	report["wrong"] = wrong;
+	cout << report.dump(4) << endl;
+
+	for(auto h : holders) delete h;
+	server.stop();
+	return (numWrongReported || numWrongOnDisk) ? 1 : 0;
+}
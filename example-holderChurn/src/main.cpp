@@ -0,0 +1,220 @@
+//
+//  main.cpp
+//  ofxAssets - example-holderChurn
+//
+//  Headless benchmark for apps that create and destroy lots of AssetHolders (ie one per page of
+//  content): several threads fill holders with synthetic remote assets and delete them again, over
+//  and over, with and without AssetHolder::setArenaAllocation(). A few small strings are kept alive
+//  across cycles, as a long running app would, so freed holder memory can get stuck between them.
+//  Prints a JSON report to stdout, with the time per cycle, the peak RSS and how much memory the
+//  allocator holds on to without using it (glibc only). Build ofxAssets with OFX_ASSETS_ARENA defined
+//  (see addon_config.mk) for the arena runs.
+//
+
+#include "ofMain.h"
+#include "ofxAssets.h"
+
+#if defined(TARGET_LINUX)
+	#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+	#include <malloc.h>
+#endif
+
+static void printUsage(){
+	cerr << "usage: example-holderChurn [--mode heap|arena|both] [--threads N] [--holders N] [--assets N]\n"
+			"       [--cycles N] [--survivors N] [--arenaKB N]" << endl;
+}
+
+
+static double secondsSince(const std::chrono::steady_clock::time_point & t){
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+}
+
+
+static uint64_t residentBytes(){
+	#if defined(TARGET_LINUX)
+	std::ifstream statm("/proc/self/statm");
+	uint64_t size = 0, resident = 0;
+	statm >> size >> resident;
+	return resident * sysconf(_SC_PAGESIZE);
+	#else
+	return 0;
+	#endif
+}
+
+
+static ofJson allocatorStats(){
+	ofJson j;
+	#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	struct mallinfo2 mi = mallinfo2();
+	j["inUseBytes"] = (uint64_t)mi.uordblks;
+	j["freeHeldBytes"] = (uint64_t)mi.fordblks; //free, but not given back to the OS
+	j["fragmentation"] = mi.arena > 0 ? (double)mi.fordblks / mi.arena : 0.0;
+	#endif
+	return j;
+}
+
+
+struct RunResult{
+	double seconds = 0;
+	vector<double> cycleMillis; //slowest worker, per cycle
+	uint64_t peakResident = 0;
+	ofJson allocatorAfter;
+	uint64_t residentAfter = 0;
+};
+
+
+static RunResult run(bool arena, size_t arenaBytes, int numThreads, int numHolders, int numAssets, int numCycles, int survivorsEvery){
+
+	AssetHolder::setArenaAllocation(arena, arenaBytes);
+	string dir = "holderChurn";
+
+	RunResult r;
+	r.cycleMillis.assign(numCycles, 0);
+	vector<vector<string>> survivors(numThreads); //the "rest of the app", allocated between holders
+	std::mutex resultMutex;
+	std::atomic<uint64_t> peak(residentBytes());
+
+	auto worker = [&](int t){
+		for(int c = 0; c < numCycles; c++){
+			auto start = std::chrono::steady_clock::now();
+			vector<AssetHolder*> holders;
+			for(int h = 0; h < numHolders; h++){
+				AssetHolder * holder = new AssetHolder();
+				holder->setup(dir, ofxAssets::UsagePolicy(), ofxAssets::DownloadPolicy());
+				for(int a = 0; a < numAssets; a++){
+					string url = "http://localhost/churn/" + ofToString(t) + "/" + ofToString(c) + "/" +
+								 ofToString(h) + "/asset_" + ofToString(a) + "_b.jpg";
+					holder->addRemoteAsset(url, "", ofxChecksum::Type::XX_HASH, {"churn", "size" + ofToString(a % 4)});
+					if(survivorsEvery > 0 && (a % survivorsEvery) == 0){
+						survivors[t].push_back(url);
+					}
+				}
+				holders.push_back(holder);
+			}
+			uint64_t rss = residentBytes();
+			uint64_t p = peak.load();
+			while(rss > p && !peak.compare_exchange_weak(p, rss)){}
+			for(auto holder : holders) delete holder;
+
+			double ms = secondsSince(start) * 1000.0;
+			std::unique_lock<std::mutex> lock(resultMutex);
+			r.cycleMillis[c] = std::max(r.cycleMillis[c], ms);
+		}
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	vector<std::thread> threads;
+	for(int t = 0; t < numThreads; t++) threads.push_back(std::thread(worker, t));
+	for(auto & t : threads) t.join();
+	r.seconds = secondsSince(start);
+
+	r.peakResident = peak.load();
+	r.residentAfter = residentBytes();
+	r.allocatorAfter = allocatorStats(); //survivors are still alive here, on purpose
+	return r;
+}
+
+
+static ofJson toJson(const RunResult & r, int numThreads, int numHolders, int numAssets){
+	ofJson j;
+	vector<double> sorted = r.cycleMillis;
+	std::sort(sorted.begin(), sorted.end());
+	double total = 0;
+	for(auto ms : sorted) total += ms;
+	uint64_t numChurned = (uint64_t)numThreads * numHolders * r.cycleMillis.size();
+	j["seconds"] = r.seconds;
+	j["holdersPerSecond"] = r.seconds > 0 ? numChurned / r.seconds : 0;
+	j["assetsPerSecond"] = r.seconds > 0 ? numChurned * numAssets / r.seconds : 0;
+	j["cycleMs"]["mean"] = sorted.size() ? total / sorted.size() : 0;
+	j["cycleMs"]["p50"] = sorted.size() ? sorted[sorted.size() / 2] : 0;
+	j["cycleMs"]["p99"] = sorted.size() ? sorted[std::min(sorted.size() - 1, sorted.size() * 99 / 100)] : 0;
+	j["cycleMs"]["max"] = sorted.size() ? sorted.back() : 0;
+	j["peakResidentBytes"] = r.peakResident;
+	j["residentBytesAfter"] = r.residentAfter;
+	j["allocatorAfter"] = r.allocatorAfter;
+	return j;
+}
+
+
+int main(int argc, char ** argv){
+
+	string mode = "both";
+	int numThreads = 4;
+	int numHolders = 20; //per thread, alive at the same time
+	int numAssets = 500; //per holder
+	int numCycles = 50;
+	int survivorsEvery = 64; //keep every Nth url alive; 0 for none
+	size_t arenaBytes = 64 * 1024;
+
+	for(int i = 1; i < argc; i++){
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(arg == "--mode" && hasValue) mode = argv[++i];
+		else if(arg == "--threads" && hasValue) numThreads = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--holders" && hasValue) numHolders = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--assets" && hasValue) numAssets = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--cycles" && hasValue) numCycles = std::max(1, ofToInt(argv[++i]));
+		else if(arg == "--survivors" && hasValue) survivorsEvery = std::max(0, ofToInt(argv[++i]));
+		else if(arg == "--arenaKB" && hasValue) arenaBytes = std::max(1, ofToInt(argv[++i])) * 1024;
+		else{ printUsage(); return 2; }
+	}
+	if(mode != "heap" && mode != "arena" && mode != "both"){
+		printUsage();
+		return 2;
+	}
+
+	if(mode != "heap" && !AssetHolder::isArenaAvailable()){
+		cerr << "ofxAssets was built without OFX_ASSETS_ARENA, only --mode heap can run" << endl;
+		return 2;
+	}
+
+	ofSetLogLevel(OF_LOG_SILENT); //stdout is for the JSON report only
+
+	ofJson report;
+	report["threads"] = numThreads;
+	report["holdersPerThread"] = numHolders;
+	report["assetsPerHolder"] = numAssets;
+	report["cycles"] = numCycles;
+	report["survivorsEvery"] = survivorsEvery;
+	report["arenaInitialBytes"] = arenaBytes;
+
+	//each mode in a child process, so one doesn't start on the other's heap
+	vector<string> modes = mode == "both" ? vector<string>{"heap", "arena"} : vector<string>{mode};
+	for(auto & m : modes){
+		if(modes.size() > 1){
+			#if defined(TARGET_LINUX) || defined(TARGET_OSX)
+			string cmd = string(argv[0]) + " --mode " + m;
+			for(int i = 1; i < argc; i++){
+				if(string(argv[i]) == "--mode"){ i++; continue; }
+				cmd += string(" ") + argv[i];
+			}
+			FILE * child = popen(cmd.c_str(), "r");
+			string out;
+			char buf[4096];
+			size_t n;
+			while(child && (n = fread(buf, 1, sizeof(buf), child)) > 0) out.append(buf, n);
+			if(child) pclose(child);
+			try{
+				report[m] = ofJson::parse(out)[m];
+			}catch(std::exception & e){
+				cerr << "'" << m << "' run failed: " << e.what() << endl;
+				return 1;
+			}
+			continue;
+			#endif
+		}
+		RunResult r = run(m == "arena", arenaBytes, numThreads, numHolders, numAssets, numCycles, survivorsEvery);
+		report[m] = toJson(r, numThreads, numHolders, numAssets);
+	}
+
+	if(report.count("heap") && report.count("arena")){
+		double heapSec = report["heap"]["seconds"], arenaSec = report["arena"]["seconds"];
+		report["arenaSpeedup"] = arenaSec > 0 ? heapSec / arenaSec : 0;
+	}
+	cout << report.dump(4) << endl;
+
+	ofDirectory::removeDirectory("holderChurn", true);
+	return 0;
+}
@@ -0,0 +1,135 @@
+//
+//  main.cpp
+//  ofxAssets - example-policyCheck
+//
+//  Headless equivalence check for ofxAssets::CompiledPolicy. Every UsagePolicy x every
+//  DownloadPolicy x every combination of the 8 LocalAssetStatus flags is decided by the compiled
+//  masks, by the reference (branchy) functions, and by the truth table below, which is written
+//  out by hand from the original AssetHolder::isReadyToUse() / shouldDownload() and shares no
+//  code with them. All three must agree. Prints a JSON report to stdout; exit code 1 on any
+//  disagreement.
+//
+
+#include "ofMain.h"
+#include "ofxAssets.h"
+
+//policy flags, as bits
+enum{
+	M = 1,	//fileMissing
+	N = 2,	//fileExistsAndNoChecksumProvided
+	MM = 4,	//fileExistsAndProvidedChecksumMissmatch
+	MA = 8,	//fileExistsAndProvidedChecksumMatch
+	S = 16	//fileTooSmall
+};
+
+//For a checked asset with these status flags: it's ready to use if the UsagePolicy has all of
+//readyIfAllOf and none of readyIfNoneOf; it's downloaded if the DownloadPolicy has any of
+//downloadIfAnyOf. Unchecked assets are never ready and never downloaded. The other 3 status
+//flags (localFileChecksumChecked, downloaded, downloadOK) don't matter.
+struct Row{
+	bool exists, supplied, match, tooSmall;
+	int readyIfAllOf, readyIfNoneOf, downloadIfAnyOf;
+};
+
+static const Row truthTable[] = {
+	//exists supplied match  tooSmall	ready all of	none of		download any of
+	{false,	false,	false,	false,		M | N,			0,			M | N},
+	{false,	false,	false,	true,		M | N | S,		0,			M | N},
+	{false,	false,	true,	false,		M,				0,			M | N},
+	{false,	false,	true,	true,		M | S,			0,			M | N},
+	{false,	true,	false,	false,		M | MM,			MA,			M | MM | MA},
+	{false,	true,	false,	true,		M | MM | S,		MA,			M | MM | MA | S},
+	{false,	true,	true,	false,		M,				0,			M},
+	{false,	true,	true,	true,		M | S,			0,			M},
+	{true,	false,	false,	false,		N,				0,			N},
+	{true,	false,	false,	true,		N | S,			0,			N},
+	{true,	false,	true,	false,		0,				0,			N},
+	{true,	false,	true,	true,		S,				0,			N},
+	{true,	true,	false,	false,		MM,				MA,			MM | MA},
+	{true,	true,	false,	true,		MM | S,			MA,			MM | MA | S},
+	{true,	true,	true,	false,		0,				0,			0},
+	{true,	true,	true,	true,		S,				0,			0},
+};
+
+
+static void policyFromBits(ofxAssets::Policy & p, int bits){
+	p.fileMissing = bits & M;
+	p.fileExistsAndNoChecksumProvided = bits & N;
+	p.fileExistsAndProvidedChecksumMissmatch = bits & MM;
+	p.fileExistsAndProvidedChecksumMatch = bits & MA;
+	p.fileTooSmall = bits & S;
+}
+
+
+static const Row & rowFor(const ofxAssets::LocalAssetStatus & s){
+	for(auto & r : truthTable){
+		if(r.exists == s.localFileExists && r.supplied == s.checksumSupplied && r.match == s.checksumMatch && r.tooSmall == s.fileTooSmall){
+			return r;
+		}
+	}
+	static Row none = {};
+	return none; //can't happen, all 16 are there
+}
+
+
+int main(int argc, char ** argv){
+
+	size_t numCases = 0, numWrongCompiled = 0, numWrongReference = 0, numWrongBulk = 0;
+	ofJson wrong = ofJson::array();
+
+	for(int u = 0; u < 32; u++){
+		for(int dl = 0; dl < 32; dl++){
+			ofxAssets::UsagePolicy usage; policyFromBits(usage, u);
+			ofxAssets::DownloadPolicy download; policyFromBits(download, dl);
+			ofxAssets::CompiledPolicy c = ofxAssets::CompiledPolicy::compile(usage, download);
+
+			vector<uint8_t> allPacked;
+			size_t expectedReady = 0, expectedDownload = 0;
+
+			for(int f = 0; f < 256; f++){
+				ofxAssets::LocalAssetStatus s;
+				s.checked = f & 1; s.localFileExists = f & 2; s.checksumSupplied = f & 4; s.checksumMatch = f & 8;
+				s.fileTooSmall = f & 16; s.localFileChecksumChecked = f & 32; s.downloaded = f & 64; s.downloadOK = f & 128;
+
+				const Row & r = rowFor(s);
+				bool ready = s.checked && (u & r.readyIfAllOf) == r.readyIfAllOf && (u & r.readyIfNoneOf) == 0;
+				bool down = s.checked && (dl & r.downloadIfAnyOf) != 0;
+				expectedReady += ready ? 1 : 0;
+				expectedDownload += down ? 1 : 0;
+
+				uint8_t packed = s.pack();
+				allPacked.push_back(packed);
+				numCases++;
+
+				bool badCompiled = c.isReadyToUse(packed) != ready || c.shouldDownload(packed) != down;
+				bool badReference = ofxAssets::CompiledPolicy::referenceIsReadyToUse(usage, s) != ready ||
+									ofxAssets::CompiledPolicy::referenceShouldDownload(download, s) != down;
+				numWrongCompiled += badCompiled ? 1 : 0;
+				numWrongReference += badReference ? 1 : 0;
+
+				if((badCompiled || badReference) && wrong.size() < 20){
+					ofJson w;
+					w["usagePolicyBits"] = u; w["downloadPolicyBits"] = dl; w["statusBits"] = f;
+					w["expectedReady"] = ready; w["expectedDownload"] = down;
+					w["compiledReady"] = c.isReadyToUse(packed); w["compiledDownload"] = c.shouldDownload(packed);
+					wrong.push_back(w);
+				}
+			}
+
+			if(c.countReady(allPacked.data(), allPacked.size()) != expectedReady ||
+			   c.countToDownload(allPacked.data(), allPacked.size()) != expectedDownload){
+				numWrongBulk++;
+			}
+		}
+	}
+
+	ofJson report;
+	report["numCases"] = numCases;
+	report["numWrongCompiled"] = numWrongCompiled;
+	report["numWrongReference"] = numWrongReference;
+	report["numWrongBulkCounts"] = numWrongBulk;
+	report["wrong"] = wrong;
+	cout << report.dump(4) << endl;
+
+	return (numWrongCompiled || numWrongReference || numWrongBulk) ? 1 : 0;
+}
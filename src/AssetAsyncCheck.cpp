@@ -0,0 +1,217 @@
+//
+//  AssetAsyncCheck.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetAsyncCheck.h"
+#include "AssetHolder.h"
+#include "AssetImagePreloader.h"
+
+
+AssetAsyncCheck::~AssetAsyncCheck(){
+	cancel();
+	for(auto & t : threads){
+		if(t.joinable()) t.join();
+	}
+}
+
+
+void AssetAsyncCheck::start(const vector<AssetHolder*> & holders_, int numThreads, bool repairCorruptChunks_,
+							AssetImagePreloader * preloader_, bool keepOpen){
+
+	repairCorruptChunks = repairCorruptChunks_;
+	preloader = preloader_;
+	AssetHolder::startVerificationPass(); //shared blobs get hashed again, once
+
+	open = true;
+	add(holders_);
+	open = keepOpen;
+	batchFuture = batchPromise.get_future().share();
+
+	if(holders.empty() && !open){
+		finish();
+		return;
+	}
+
+	numThreads = std::max(1, open ? numThreads : std::min(numThreads, (int)holders.size()));
+	numRunningWorkers = numThreads;
+	for(int i = 0; i < numThreads; i++){
+		threads.emplace_back(&AssetAsyncCheck::workerFunction, this);
+	}
+}
+
+
+void AssetAsyncCheck::workerFunction(){
+
+	#ifdef TARGET_WIN32
+	#elif defined(TARGET_LINUX)
+	pthread_setname_np(pthread_self(), "AssetAsyncCheck");
+	#else
+	pthread_setname_np("AssetAsyncCheck");
+	#endif
+
+	while(!canceled){
+		size_t i;
+		AssetHolder * holder;
+		{
+			std::unique_lock<std::mutex> lock(asyncMutex);
+			moreWork.wait(lock, [this]{ return canceled || next < holders.size() || !open; });
+			if(canceled || next >= holders.size()) break;
+			i = next++;
+			holder = holders[i];
+		}
+		holder->updateLocalAssetsStatus(&counters);
+		if(repairCorruptChunks){
+			holder->repairCorruptChunks();
+		}
+		if(preloader){
+			preloader->addHolder(holder);
+		}
+		completeHolder(i, true);
+	}
+
+	if(--numRunningWorkers == 0){ //last one out
+		finish();
+	}
+}
+
+
+void AssetAsyncCheck::completeHolder(size_t index, bool checked){
+
+	vector<std::function<void(AssetHolder*, bool)>> continuations;
+	asyncMutex.lock();
+	AssetHolder * holder = holders[index];
+	std::promise<bool> & promise = holderPromises[index];
+	completed.push_back(std::make_pair(holder, checked));
+	continuations = holderContinuations;
+	asyncMutex.unlock();
+
+	promise.set_value(checked);
+	for(auto & c : continuations){
+		c(holder, checked);
+	}
+}
+
+
+void AssetAsyncCheck::finish(){
+
+	//whatever didnt get its turn because we were canceled
+	asyncMutex.lock();
+	open = false; //too late for add()
+	size_t numScheduled = std::min<size_t>(next, holders.size());
+	size_t numHolders = holders.size();
+	asyncMutex.unlock();
+	for(size_t i = numScheduled; i < numHolders; i++){
+		completeHolder(i, false);
+	}
+
+	vector<std::function<void(bool)>> continuations;
+	asyncMutex.lock();
+	allChecked = !canceled || numScheduled == numHolders;
+	finished = true;
+	continuations = batchContinuations;
+	asyncMutex.unlock();
+
+	batchPromise.set_value(allChecked);
+	for(auto & c : continuations){
+		c(allChecked);
+	}
+}
+
+
+std::shared_future<bool> AssetAsyncCheck::getFuture(){
+	return batchFuture;
+}
+
+
+std::shared_future<bool> AssetAsyncCheck::getFuture(AssetHolder * holder){
+	std::unique_lock<std::mutex> lock(asyncMutex);
+	for(size_t i = 0; i < holders.size(); i++){
+		if(holders[i] == holder) return holderFutures[i];
+	}
+	ofLogError("AssetAsyncCheck") << "getFuture() that AssetHolder is not part of this check!";
+	return std::shared_future<bool>();
+}
+
+
+void AssetAsyncCheck::then(std::function<void(AssetHolder*, bool)> onHolderDone){
+	vector<std::pair<AssetHolder*, bool>> alreadyDone;
+	asyncMutex.lock();
+	holderContinuations.push_back(onHolderDone);
+	alreadyDone = completed;
+	asyncMutex.unlock();
+	for(auto & it : alreadyDone){
+		onHolderDone(it.first, it.second);
+	}
+}
+
+
+void AssetAsyncCheck::onFinished(std::function<void(bool)> onBatchDone){
+	asyncMutex.lock();
+	batchContinuations.push_back(onBatchDone);
+	bool alreadyFinished = finished;
+	bool result = allChecked;
+	asyncMutex.unlock();
+	if(alreadyFinished){
+		onBatchDone(result);
+	}
+}
+
+
+void AssetAsyncCheck::cancel(){
+	{ //under the mutex, or a waiting worker can miss it
+		std::unique_lock<std::mutex> lock(asyncMutex);
+		canceled = true;
+	}
+	moreWork.notify_all();
+}
+
+
+void AssetAsyncCheck::add(const vector<AssetHolder*> & newHolders){
+	{
+		std::unique_lock<std::mutex> lock(asyncMutex);
+		if(!open){
+			ofLogError("AssetAsyncCheck") << "Can't add() AssetHolders, this check is closed!";
+			return;
+		}
+		for(auto h : newHolders){
+			holders.push_back(h);
+			holderPromises.emplace_back();
+			holderFutures.push_back(holderPromises.back().get_future().share());
+		}
+	}
+	moreWork.notify_all();
+}
+
+
+void AssetAsyncCheck::close(){
+	{
+		std::unique_lock<std::mutex> lock(asyncMutex);
+		open = false;
+	}
+	moreWork.notify_all(); //idle workers leave, the last one out finishes
+}
+
+
+size_t AssetAsyncCheck::getNumPending(){
+	std::unique_lock<std::mutex> lock(asyncMutex);
+	return holders.size() - completed.size();
+}
+
+
+void AssetAsyncCheck::wait(){
+	batchFuture.wait();
+}
+
+
+bool AssetAsyncCheck::isFinished(){
+	std::unique_lock<std::mutex> lock(asyncMutex);
+	return finished;
+}
+
+
+float AssetAsyncCheck::getProgress(){
+	std::unique_lock<std::mutex> lock(asyncMutex);
+	return holders.size() ? completed.size() / float(holders.size()) : 1.0f;
+}
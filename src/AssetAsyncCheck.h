@@ -0,0 +1,87 @@
+//
+//  AssetAsyncCheck.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "AssetHolderStructs.h"
+#include <future>
+
+class AssetHolder;
+class AssetImagePreloader;
+
+//A batch of AssetHolders being checked in the background, see AssetChecker::checkAsync().
+//Doesn't need AssetChecker::update() or an OF main loop: the worker threads fulfill the futures
+//and run the continuations themselves, so it works in headless / non-oF processes.
+//Continuations run on a worker thread; chain your downloads from there (ie call
+//downloadMissingAssets() on each holder as it gets checked). Continuations added after the fact
+//are called right away for whatever already completed.
+//Destroying it cancels what's left and waits for the workers; don't drop your last reference to it
+//from inside one of its own continuations.
+//A check started with AssetChecker::checkAsyncFeed() takes its holders as they come, with add(),
+//on the same worker threads; it only finishes after close().
+
+class AssetAsyncCheck{
+
+	friend class AssetChecker;
+
+public:
+
+	~AssetAsyncCheck();
+
+	std::shared_future<bool> getFuture(); //whole batch; true if all holders were checked, false if canceled
+	std::shared_future<bool> getFuture(AssetHolder * holder); //true when checked, false if canceled before its turn
+
+	void then(std::function<void(AssetHolder * holder, bool checked)> onHolderDone);
+	void onFinished(std::function<void(bool allChecked)> onBatchDone);
+
+	void cancel(); //holders being checked right now will finish, the rest wont be checked
+	void wait();
+
+	void add(const vector<AssetHolder*> & holders); //checkAsyncFeed() only, before close()
+	void close(); //no more holders coming; finishes once the ones added are checked
+	size_t getNumPending(); //added and not checked yet
+
+	bool isFinished();
+	bool isCanceled(){return canceled;}
+	float getProgress();
+	const ofxAssets::CheckCounters & getCounters(){return counters;}
+
+protected:
+
+	AssetAsyncCheck(){};
+	void start(const vector<AssetHolder*> & holders, int numThreads, bool repairCorruptChunks, AssetImagePreloader * preloader,
+			   bool keepOpen = false);
+	void workerFunction();
+	void completeHolder(size_t index, bool checked);
+	void finish();
+
+	//deques: add() appends while workers hold on to elements
+	std::deque<AssetHolder*> holders;
+	std::deque<std::promise<bool>> holderPromises;
+	std::deque<std::shared_future<bool>> holderFutures;
+	std::promise<bool> batchPromise;
+	std::shared_future<bool> batchFuture;
+
+	vector<std::pair<AssetHolder*, bool>> completed;
+	vector<std::function<void(AssetHolder*, bool)>> holderContinuations;
+	vector<std::function<void(bool)>> batchContinuations;
+	bool finished = false;
+	bool allChecked = false;
+	bool open = false; //add() allowed, workers wait for more
+
+	vector<std::thread> threads;
+	size_t next = 0; //under asyncMutex
+	std::atomic<int> numRunningWorkers{0};
+	std::atomic<bool> canceled{false};
+	ofxAssets::CheckCounters counters;
+
+	bool repairCorruptChunks = false;
+	AssetImagePreloader * preloader = nullptr;
+
+	std::mutex asyncMutex;
+	std::condition_variable moreWork;
+};
@@ -0,0 +1,39 @@
+//
+//  AssetBandwidthLimiter.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetBandwidthLimiter.h"
+
+using namespace ofxAssets;
+
+
+void BandwidthLimiter::setMaxBytesPerSecond(uint64_t bytesPerSec){
+	std::unique_lock<std::mutex> lock(limiterMutex);
+	rate = bytesPerSec;
+	available = 0;
+	lastRefill = std::chrono::steady_clock::now();
+}
+
+
+void BandwidthLimiter::consume(size_t numBytes){
+
+	if(rate == 0) return;
+
+	double waitSeconds = 0;
+	{
+		std::unique_lock<std::mutex> lock(limiterMutex);
+		auto now = std::chrono::steady_clock::now();
+		double elapsed = std::chrono::duration<double>(now - lastRefill).count();
+		lastRefill = now;
+		available = std::min<double>(available + elapsed * rate, rate); //allow up to 1s of burst
+		available -= numBytes;
+		if(available < 0){
+			waitSeconds = -available / rate;
+		}
+	}
+	if(waitSeconds > 0){
+		std::this_thread::sleep_for(std::chrono::duration<double>(waitSeconds));
+	}
+}
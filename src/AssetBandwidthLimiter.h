@@ -0,0 +1,31 @@
+//
+//  AssetBandwidthLimiter.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+namespace ofxAssets{
+
+	//token bucket shared by any number of download threads; each one calls consume() with the
+	//bytes it just got, and sleeps there as long as needed to keep the total under the limit
+	class BandwidthLimiter{
+
+	public:
+
+		void setMaxBytesPerSecond(uint64_t bytesPerSec); //0 for no limit
+		uint64_t getMaxBytesPerSecond(){return rate;}
+
+		void consume(size_t numBytes);
+
+	protected:
+
+		std::atomic<uint64_t> rate{0};
+		double available = 0; //bytes we can still take; negative if we owe
+		std::chrono::steady_clock::time_point lastRefill = std::chrono::steady_clock::now();
+		std::mutex limiterMutex;
+	};
+}
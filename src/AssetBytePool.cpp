@@ -0,0 +1,83 @@
+//
+//  AssetBytePool.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetBytePool.h"
+
+using namespace ofxAssets;
+
+
+void BytePool::setMemoryBudget(size_t numBytes){
+	ofScopedLock lock(mutex);
+	budget = numBytes;
+	evictUntilFits(0);
+}
+
+
+size_t BytePool::getMemoryUsed(){
+	ofScopedLock lock(mutex);
+	return used;
+}
+
+
+void BytePool::store(const string & relativePath, ofBuffer && bytes){
+
+	ofScopedLock lock(mutex);
+	if(bytes.size() > budget) return;
+
+	auto it = buffers.find(relativePath);
+	if(it != buffers.end()){ //replace old copy
+		used -= it->second.bytes->size();
+		storeOrder.erase(it->second.order);
+		buffers.erase(it);
+	}
+
+	evictUntilFits(bytes.size());
+	used += bytes.size();
+	Entry & e = buffers[relativePath];
+	e.bytes = std::make_shared<const ofBuffer>(std::move(bytes));
+	e.order = storeOrder.insert(storeOrder.end(), relativePath);
+}
+
+
+std::shared_ptr<const ofBuffer> BytePool::get(const string & relativePath){
+	ofScopedLock lock(mutex);
+	auto it = buffers.find(relativePath);
+	if(it != buffers.end()){
+		return it->second.bytes;
+	}
+	return nullptr;
+}
+
+
+void BytePool::release(const string & relativePath){
+	ofScopedLock lock(mutex);
+	auto it = buffers.find(relativePath);
+	if(it != buffers.end()){
+		used -= it->second.bytes->size();
+		storeOrder.erase(it->second.order);
+		buffers.erase(it);
+	}
+}
+
+
+void BytePool::clear(){
+	ofScopedLock lock(mutex);
+	buffers.clear();
+	storeOrder.clear();
+	used = 0;
+}
+
+
+void BytePool::evictUntilFits(size_t numBytes){
+	while(used + numBytes > budget && storeOrder.size()){
+		auto it = buffers.find(storeOrder.front());
+		if(it != buffers.end()){
+			used -= it->second.bytes->size();
+			buffers.erase(it);
+		}
+		storeOrder.pop_front();
+	}
+}
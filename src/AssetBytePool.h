@@ -0,0 +1,46 @@
+//
+//  AssetBytePool.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+//keeps the bytes of assets that were just read to be verified, so the app can load them
+//(ofLoadImage(pix, buffer), ofJson::parse(buffer.getText()), etc) without reading them again.
+//Oldest entries are dropped when over budget. Thread safe, checker threads fill it up.
+namespace ofxAssets{
+
+	class BytePool{
+
+	public:
+
+		void setMemoryBudget(size_t numBytes);
+		size_t getMemoryBudget(){return budget;}
+		size_t getMemoryUsed();
+
+		bool canHold(size_t numBytes){return numBytes <= budget;}
+
+		void store(const string & relativePath, ofBuffer && bytes);
+		std::shared_ptr<const ofBuffer> get(const string & relativePath); //nullptr if not here
+		void release(const string & relativePath);
+		void clear();
+
+	protected:
+
+		void evictUntilFits(size_t numBytes); //call with mutex locked!
+
+		struct Entry{
+			std::shared_ptr<const ofBuffer> bytes;
+			std::list<string>::iterator order; //where it is in storeOrder, to drop it from there in O(1)
+		};
+
+		std::unordered_map<string, Entry> buffers; //by relativePath
+		std::list<string> storeOrder; //oldest first
+		size_t budget = 0;
+		size_t used = 0;
+		ofMutex mutex;
+	};
+}
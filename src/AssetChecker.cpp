@@ -8,19 +8,56 @@
 
 #include "AssetChecker.h"
 #include "AssetHolder.h"
+#include "AssetImagePreloader.h"
+#include "AssetAsyncCheck.h"
+#ifndef TARGET_WIN32
+#include <sys/stat.h>
+#endif
 
 
-void AssetCheckThread::checkAssetsInThread(const vector<AssetHolder*>& assetObjects_, ofMutex * mutex){
+void AssetCheckThread::checkAssetsInThread(const vector<AssetHolder*>& assetObjects_, ofMutex * mutex,
+											AssetImagePreloader * preloader_, ofxAssets::CheckCounters * counters_){
 	if(isThreadRunning()){
 		ofLogError("AssetCheckThread") << "thread already running!";
 	}
 	myMutex = mutex;
+	preloader = preloader_;
+	counters = counters_;
 	assetObjects = assetObjects_;
 	progress = 0;
+	statPassDone = false;
 	startThread();
 }
 
 
+void AssetCheckThread::checkAssetsInThread(AssetCheckQueue * queue_, int threadIndex_, ofMutex * mutex,
+											AssetImagePreloader * preloader_){
+	if(isThreadRunning()){
+		ofLogError("AssetCheckThread") << "thread already running!";
+	}
+	myMutex = mutex;
+	preloader = preloader_;
+	queue = queue_;
+	counters = queue->counters;
+	threadIndex = threadIndex_;
+	assetObjects.clear();
+	progress = 0;
+	statPassDone = false;
+	startThread();
+}
+
+
+void AssetCheckThread::checkHolder(AssetHolder * holder){
+	holder->updateLocalAssetsStatus(counters);
+	if(repairCorruptChunks){
+		holder->repairCorruptChunks();
+	}
+	if(preloader){
+		preloader->addHolder(holder);
+	}
+}
+
+
 void AssetCheckThread::threadedFunction(){
 
 	#ifdef TARGET_WIN32
@@ -34,17 +71,144 @@ void AssetCheckThread::threadedFunction(){
 //	ofLogNotice("AssetCheckThread") << "thread checking " << assetObjects.size() << " obj.";
 //	myMutex->unlock();
 
-	for(int i = 0; i < assetObjects.size(); i++){
-		assetObjects[i]->updateLocalAssetsStatus();
-		progress = (i + 1) / float(assetObjects.size());
+	//stat pass first, so progress can be byte weighted
+	if(counters){
+		if(queue){
+			for(size_t i = threadIndex; i < queue->assetObjects.size(); i += queue->numThreads){
+				queue->assetObjects[i]->addToCheckTotals(counters);
+			}
+		}else{
+			for(auto h : assetObjects) h->addToCheckTotals(counters);
+		}
+	}
+	statPassDone = true;
+
+	if(queue){ //auto tuned, keep pulling work until there's none left
+
+		size_t total = queue->assetObjects.size();
+		while(true){
+			if(threadIndex >= queue->numActiveThreads){ //the tuner wants us idle for now
+				if(queue->next >= total) break;
+				ofSleepMillis(20);
+				continue;
+			}
+			size_t i = queue->next++;
+			if(i >= total) break;
+			checkHolder(queue->assetObjects[i]);
+			progress = (++queue->numChecked) / float(total);
+		}
+
+	}else{
+
+		for(int i = 0; i < assetObjects.size(); i++){
+			checkHolder(assetObjects[i]);
+			progress = (i + 1) / float(assetObjects.size());
+		}
+		progress = 1.0;
 	}
-	progress = 1.0;
 	ofNotifyEvent(eventFinishedCheckingAssets, this);
 	ofSleepMillis(24);
 }
 
 /////////////////////////////////////////////////////////////////////////////////////////////////////
 
+void AssetCheckTuner::start(AssetCheckQueue * queue_, int initialThreads, int maxThreads_, float intervalSeconds){
+	queue = queue_;
+	maxThreads = std::max(1, maxThreads_);
+	interval = intervalSeconds;
+	bestNumThreads = initialThreads;
+	bestBytesPerSec = bestFilesPerSec = 0;
+	queue->numActiveThreads = initialThreads;
+	startThread();
+}
+
+
+void AssetCheckTuner::stop(){
+	if(isThreadRunning()){
+		{ //under the mutex, or the wake up can be lost
+			std::unique_lock<std::mutex> lock(tunerMutex);
+			stopThread();
+		}
+		wakeUp.notify_all();
+	}
+	waitForThread(false);
+}
+
+
+void AssetCheckTuner::threadedFunction(){
+
+	#ifdef TARGET_WIN32
+	#elif defined(TARGET_LINUX)
+	pthread_setname_np(pthread_self(), "AssetCheckTuner");
+	#else
+	pthread_setname_np("AssetCheckTuner");
+	#endif
+
+	//opening + stat'ing + closing a file costs about as much as reading this many bytes
+	const float bytesPerFileOverhead = 64 * 1024;
+
+	size_t total = queue->assetObjects.size();
+	int current = queue->numActiveThreads;
+	int direction = 1;
+	float prevScore = -1;
+	uint64_t lastBytes = queue->counters->numBytes;
+	uint64_t lastFiles = queue->counters->numFiles;
+	float lastTime = ofGetElapsedTimef();
+
+	struct Sample{ float score = 0; float bytesPerSec = 0; float filesPerSec = 0; };
+	std::map<int, Sample> samples; //by num of active threads
+
+	while(queue->numChecked < total){
+
+		{ //stop() wakes us up, so the main thread doesn't wait out the interval
+			std::unique_lock<std::mutex> lock(tunerMutex);
+			wakeUp.wait_for(lock, std::chrono::duration<float>(interval), [this]{ return !isThreadRunning(); });
+		}
+		if(!isThreadRunning()) break;
+
+		float now = ofGetElapsedTimef();
+		float dt = now - lastTime;
+		if(dt <= 0.0f) continue;
+		uint64_t bytes = queue->counters->numBytes;
+		uint64_t files = queue->counters->numFiles;
+		float bytesPerSec = (bytes - lastBytes) / dt;
+		float filesPerSec = (files - lastFiles) / dt;
+		lastBytes = bytes; lastFiles = files; lastTime = now;
+		float score = bytesPerSec + filesPerSec * bytesPerFileOverhead;
+
+		Sample & smp = samples[current]; //smooth out noise
+		smp.score = (smp.score == 0) ? score : 0.5f * (smp.score + score);
+		smp.bytesPerSec = bytesPerSec;
+		smp.filesPerSec = filesPerSec;
+
+		bool hold = false;
+		if(prevScore >= 0){
+			if(score < prevScore * 0.95f){
+				direction = -direction; //got worse, go back
+			}else if(score < prevScore * 1.05f){
+				hold = true; //no better, no worse: settled, stay here until that changes
+			}
+		}
+		prevScore = score;
+		if(hold) continue;
+
+		current = ofClamp(current + direction, 1, maxThreads); //at the limit we just stay there
+		queue->numActiveThreads = current;
+	}
+
+	float bestScore = -1;
+	for(auto & it : samples){
+		if(it.second.score > bestScore){
+			bestScore = it.second.score;
+			bestNumThreads = it.first;
+			bestBytesPerSec = it.second.bytesPerSec;
+			bestFilesPerSec = it.second.filesPerSec;
+		}
+	}
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void AssetChecker::update(){
 
 	if (started){
@@ -56,10 +220,17 @@ void AssetChecker::update(){
 			}
 		}
 		if(numThreadsCompleted == threads.size() && numRunningThreads == 0){
+			totalsKnown = true; //all stat passes are over; even if nobody asked for progress before
 			for(int i = 0; i < threads.size(); i++){
 				delete threads[i];
 			}
 			threads.clear();
+			if(tuner){
+				tuner->stop();
+				saveTuning();
+				delete tuner; tuner = nullptr;
+				delete queue; queue = nullptr;
+			}
 			started = false;
 			ofNotifyEvent(eventFinishedCheckingAllAssets, this);
 		}
@@ -70,22 +241,34 @@ void AssetChecker::update(){
 
 string AssetChecker::getDrawableState(){
 
-	if(started){
-		string msg;
-		msg += "AssetChecker : checking assets integrity.";
-		msg += "\n\n";
-		vector<float> progress = getPerThreadProgress();
-		for(int i = 0; i < progress.size(); i++){
-			char aux[4]; sprintf(aux, "%02d", i);
-			msg += "  Thread (" + string(aux) + "): " + ofToString(100 * progress[i], 1) +
-			"% done. (" + ofToString((int)threads[i]->getNumObjectsChecked()) + " of " +
-			ofToString((int)threads[i]->getNumObjectsToCheck()) + " Assets Checked)\n";
-		}
-		return msg;
-	}else{
+	if(!started){
 		return "AssetChecker : Idle";
 	}
 
+	float now = ofGetElapsedTimef();
+	if(drawableStateTime >= 0 && now - drawableStateTime < 0.1f){
+		return drawableState;
+	}
+	drawableStateTime = now;
+
+	ofxAssets::CheckProgress p = getProgressSnapshot();
+	string & msg = drawableState;
+	msg.clear();
+	msg += "AssetChecker : checking assets integrity.\n\n";
+	msg += "  " + ofToString(100 * p.progress, 1) + "% done. " + ofToString(p.numFiles) + " of " + ofToString(p.totalFiles) +
+			(p.totalsKnown ? "" : "+") + " files, " + ofToString(p.numBytes / (1024.0 * 1024.0), 1) + " of " +
+			ofToString(p.totalBytes / (1024.0 * 1024.0), 1) + " MB.\n";
+	msg += "  " + ofToString(p.bytesPerSecond / (1024.0 * 1024.0), 1) + " MB/s, " + ofToString(p.filesPerSecond, 0) + " files/s. ETA: " +
+			(p.eta >= 0 ? ofToString(p.eta, 0) + "s" : string("?")) + "\n\n";
+	if(queue){
+		msg += "  Auto tuned: " + ofToString((int)queue->numActiveThreads) + " of " + ofToString(threads.size()) + " threads active.\n\n";
+	}
+	for(int i = 0; i < threads.size(); i++){
+		msg += "  Thread (" + string(i < 10 ? "0" : "") + ofToString(i) + "): " + ofToString(100 * threads[i]->getProgress(), 1) +
+		"% done. (" + ofToString((int)threads[i]->getNumObjectsChecked()) + " of " +
+		ofToString((int)threads[i]->getNumObjectsToCheck()) + " Assets Checked)\n";
+	}
+	return msg;
 }
 
 void AssetChecker::checkAssets(vector<AssetHolder*> assetObjects_, int numThreads){
@@ -94,6 +277,11 @@ void AssetChecker::checkAssets(vector<AssetHolder*> assetObjects_, int numThread
 	float nPerThread = float(assetObjects.size()) / float(numThreads);
 	numThreadsCompleted = 0;
 	started = true;
+	counters.reset();
+	AssetHolder::startVerificationPass(); //shared blobs get hashed again, once
+	totalsKnown = false;
+	startTime = ofGetElapsedTimef();
+	drawableStateTime = -1;
 
 	int numAssets = 0;
 	for(auto & obj : assetObjects){
@@ -126,18 +314,172 @@ void AssetChecker::checkAssets(vector<AssetHolder*> assetObjects_, int numThread
 		}
 		//mutex.unlock();
 
+		t->setRepairCorruptChunks(repairCorruptChunks);
 		ofAddListener(t->eventFinishedCheckingAssets, this, &AssetChecker::onAssetCheckThreadFinished);
-		t->checkAssetsInThread(objsForThisThread, &mutex);
+		t->checkAssetsInThread(objsForThisThread, &mutex, preloader, &counters);
+	}
+}
+
+
+void AssetChecker::checkAssetsAutoTuned(vector<AssetHolder*> assetObjects_, int maxThreads, const string & tuningFile_){
+
+	if(started){
+		ofLogError("AssetChecker") << "Can't start checking, already checking assets!";
+		return;
+	}
+
+	assetObjects = assetObjects_;
+	maxThreads = std::max(1, maxThreads);
+	tuningFile = tuningFile_;
+	storageDevice = assetObjects.size() ? storageDeviceFor(assetObjects[0]->getDirectoryForAssets()) : "unknown";
+
+	//start from what worked best last time on this device
+	int initialThreads = std::min(4, maxThreads);
+	if(ofFile::doesFileExist(tuningFile)){
+		try{
+			ofJson tuning = ofLoadJson(tuningFile);
+			if(tuning.is_object() && tuning.count(storageDevice)){
+				initialThreads = ofClamp(tuning[storageDevice]["numThreads"].get<int>(), 1, maxThreads);
+			}
+		}catch(std::exception & e){
+			ofLogWarning("AssetChecker") << "Ignoring bad tuning file \"" << tuningFile << "\": " << e.what();
+		}
+	}
+
+	ofLogNotice("AssetChecker") << "Start auto tuned CheckAssets! " << initialThreads << " active threads (max " << maxThreads <<
+	") for storage device \"" << storageDevice << "\"";
+
+	queue = new AssetCheckQueue();
+	queue->assetObjects = assetObjects;
+	queue->numActiveThreads = initialThreads;
+	queue->numThreads = maxThreads;
+	queue->counters = &counters;
+	numThreadsCompleted = 0;
+	started = true;
+	counters.reset();
+	AssetHolder::startVerificationPass(); //shared blobs get hashed again, once
+	totalsKnown = false;
+	startTime = ofGetElapsedTimef();
+	drawableStateTime = -1;
+
+	for(int i = 0; i < maxThreads; i++){
+		AssetCheckThread * t = new AssetCheckThread();
+		threads.push_back(t);
+		t->setRepairCorruptChunks(repairCorruptChunks);
+		ofAddListener(t->eventFinishedCheckingAssets, this, &AssetChecker::onAssetCheckThreadFinished);
+		t->checkAssetsInThread(queue, i, &mutex, preloader);
+	}
+
+	tuner = new AssetCheckTuner();
+	tuner->start(queue, initialThreads, maxThreads, 0.5);
+}
+
+
+std::shared_ptr<AssetAsyncCheck> AssetChecker::checkAsync(const vector<AssetHolder*> & assetObjects_, int numThreads){
+	std::shared_ptr<AssetAsyncCheck> check(new AssetAsyncCheck());
+	check->start(assetObjects_, numThreads, repairCorruptChunks, preloader);
+	return check;
+}
+
+
+std::shared_ptr<AssetAsyncCheck> AssetChecker::checkAsyncFeed(int numThreads){
+	std::shared_ptr<AssetAsyncCheck> check(new AssetAsyncCheck());
+	check->start(vector<AssetHolder*>(), numThreads, repairCorruptChunks, preloader, true);
+	return check;
+}
+
+
+void AssetChecker::saveTuning(){
+
+	if(tuningFile.empty() || tuner->getBestBytesPerSecond() + tuner->getBestFilesPerSecond() <= 0) return;
+
+	ofJson tuning;
+	if(ofFile::doesFileExist(tuningFile)){
+		try{
+			tuning = ofLoadJson(tuningFile);
+		}catch(std::exception & e){}
+	}
+	if(!tuning.is_object()) tuning = ofJson::object();
+
+	tuning[storageDevice]["numThreads"] = tuner->getBestNumThreads();
+	tuning[storageDevice]["bytesPerSecond"] = tuner->getBestBytesPerSecond();
+	tuning[storageDevice]["filesPerSecond"] = tuner->getBestFilesPerSecond();
+	ofSavePrettyJson(tuningFile, tuning);
+
+	ofLogNotice("AssetChecker") << "Best for storage device \"" << storageDevice << "\": " << tuner->getBestNumThreads() <<
+	" threads (" << tuner->getBestBytesPerSecond() / (1024 * 1024) << " MB/s, " << tuner->getBestFilesPerSecond() << " files/s)";
+}
+
+
+string AssetChecker::storageDeviceFor(const string & path){
+
+	string absPath = ofToDataPath(path, true);
+	#ifdef TARGET_WIN32
+	return std::filesystem::path(absPath).root_name().string();
+	#else
+	struct stat st;
+	if(stat(absPath.c_str(), &st) == 0){
+		return ofToString((uint64_t)st.st_dev);
 	}
+	return "unknown";
+	#endif
 }
 
 
 float AssetChecker::getProgress(){
-	float progress = 0.0f;
-	for(int i = 0; i < threads.size(); i++){
-		progress += threads[i]->getProgress() / (threads.size());
+	return getProgressSnapshot().progress;
+}
+
+
+ofxAssets::CheckProgress AssetChecker::getProgressSnapshot(){
+
+	ofxAssets::CheckProgress p;
+	p.numFiles = counters.numFiles;
+	p.numBytes = counters.numBytes;
+	p.totalFiles = counters.totalFiles;
+	p.totalBytes = counters.totalBytes;
+	if(!totalsKnown && threads.size()){ //latched, they stay known once the threads are gone
+		bool allDone = true;
+		for(auto t : threads){
+			if(!t->isStatPassDone()) allDone = false;
+		}
+		totalsKnown = allDone;
+	}
+	p.totalsKnown = totalsKnown;
+
+	if(!started){ //done, or never started
+		p.progress = (p.numFiles > 0 || p.totalFiles > 0) ? 1.0f : 0.0f;
+		p.eta = 0;
+		return p;
+	}
+
+	p.elapsed = ofGetElapsedTimef() - startTime;
+	if(p.elapsed > 0){
+		p.bytesPerSecond = p.numBytes / p.elapsed;
+		p.filesPerSecond = p.numFiles / p.elapsed;
 	}
-	return  progress;
+
+	if(p.totalsKnown){
+		const double bytesPerFile = 64 * 1024; //same weight the auto tuner gives to opening a file
+		double total = p.totalBytes + p.totalFiles * bytesPerFile;
+		double done = p.numBytes + p.numFiles * bytesPerFile;
+		p.progress = total > 0 ? ofClamp(done / total, 0, 1) : 1.0f;
+		double rate = p.bytesPerSecond + p.filesPerSecond * bytesPerFile;
+		if(rate > 0 && p.elapsed > 0.5f){
+			p.eta = std::max(0.0, (total - done) / rate);
+		}
+	}else{ //stat pass still going, count holders for now
+		float progress = 0.0f;
+		if(queue){
+			progress = queue->assetObjects.size() ? queue->numChecked / float(queue->assetObjects.size()) : 1.0f;
+		}else{
+			for(int i = 0; i < threads.size(); i++){
+				progress += threads[i]->getProgress() / threads.size();
+			}
+		}
+		p.progress = progress;
+	}
+	return p;
 }
 
 
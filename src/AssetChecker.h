@@ -10,27 +10,85 @@
 #define __BaseApp__AssetChecker__
 
 #include "ofMain.h"
+#include "AssetHolderStructs.h"
 
 class AssetHolder;
+class AssetImagePreloader;
+class AssetAsyncCheck;
+
+struct AssetCheckQueue{ //shared by all AssetCheckThreads when auto tuning; they pull work from here
+	vector<AssetHolder*> assetObjects;
+	std::atomic<size_t> next;
+	std::atomic<size_t> numChecked;
+	std::atomic<int> numActiveThreads; //threads beyond this one sit idle
+	int numThreads = 1; //active or not; the stat pass is split across all of them
+	ofxAssets::CheckCounters * counters = nullptr;
+	AssetCheckQueue(){
+		next = numChecked = 0;
+		numActiveThreads = 1;
+	}
+};
 
 class AssetCheckThread : public ofThread{
 
 public:
 
-	void checkAssetsInThread(const vector<AssetHolder*>& assetObjects, ofMutex * mutex);
+	void checkAssetsInThread(const vector<AssetHolder*>& assetObjects, ofMutex * mutex,
+							 AssetImagePreloader * preloader = nullptr, ofxAssets::CheckCounters * counters = nullptr);
+
+	//pull work from a shared queue instead; threadIndex decides if this thread is active or idle
+	void checkAssetsInThread(AssetCheckQueue * queue, int threadIndex, ofMutex * mutex,
+							 AssetImagePreloader * preloader = nullptr);
+
+	void setRepairCorruptChunks(bool repair){repairCorruptChunks = repair;}
 
 	float getProgress(){return progress;}
+	bool isStatPassDone(){return statPassDone;}
 	ofEvent<void> eventFinishedCheckingAssets;
 
-	int getNumObjectsToCheck(){return assetObjects.size();};
-	int getNumObjectsChecked(){ return assetObjects.size() * progress; };
+	int getNumObjectsToCheck(){return queue ? queue->assetObjects.size() : assetObjects.size();};
+	int getNumObjectsChecked(){ return getNumObjectsToCheck() * progress; };
 
 private:
 
-	float progress = 0;
+	std::atomic<float> progress{0}; //in holders
+	std::atomic<bool> statPassDone{false};
+	ofxAssets::CheckCounters * counters = nullptr;
 	ofMutex * myMutex = nullptr;
+	AssetImagePreloader * preloader = nullptr;
+	bool repairCorruptChunks = false;
 	void threadedFunction();
+	void checkHolder(AssetHolder * holder);
 	vector<AssetHolder*> assetObjects;
+	AssetCheckQueue * queue = nullptr;
+	int threadIndex = 0;
+};
+
+
+//watches check throughput (files/s and bytes/s) while an auto tuned check runs, and moves the
+//number of active AssetCheckThreads up or down towards the fastest setting
+class AssetCheckTuner : public ofThread{
+
+public:
+
+	void start(AssetCheckQueue * queue, int initialThreads, int maxThreads, float intervalSeconds);
+	void stop(); //returns right away, even mid interval
+	int getBestNumThreads(){return bestNumThreads;}
+	float getBestBytesPerSecond(){return bestBytesPerSec;}
+	float getBestFilesPerSecond(){return bestFilesPerSec;}
+
+private:
+
+	void threadedFunction();
+
+	AssetCheckQueue * queue = nullptr;
+	int maxThreads = 1;
+	float interval = 0.5;
+	int bestNumThreads = 1;
+	float bestBytesPerSec = 0;
+	float bestFilesPerSec = 0;
+	std::mutex tunerMutex;
+	std::condition_variable wakeUp;
 };
 
 
@@ -42,11 +100,34 @@ public:
 	AssetChecker(){};
 
 	void checkAssets(vector<AssetHolder*> assetObjects, int numThreads = std::thread::hardware_concurrency());
+
+	//like checkAssets(), but measures throughput as it goes and adjusts the number of active threads
+	//(up to maxThreads) to whatever checks fastest. The best setting is remembered per storage device
+	//(in tuningFile) and used as a starting point next time.
+	void checkAssetsAutoTuned(vector<AssetHolder*> assetObjects, int maxThreads = std::thread::hardware_concurrency(),
+							  const string & tuningFile = "logs/assetCheckerTuning.json");
+
+	//check in the background without update() / events; see AssetAsyncCheck for futures, continuations
+	//and cancellation. Independent from checkAssets(), you can have several running at once.
+	std::shared_ptr<AssetAsyncCheck> checkAsync(const vector<AssetHolder*> & assetObjects,
+												 int numThreads = std::thread::hardware_concurrency());
+	//same, starting with no holders: add() them as you get them, close() it when there are no more
+	std::shared_ptr<AssetAsyncCheck> checkAsyncFeed(int numThreads = std::thread::hardware_concurrency());
+
 	void update();
-	float getProgress();
+	float getProgress(); //byte weighted once the stat pass is done
+	ofxAssets::CheckProgress getProgressSnapshot(); //cheap, call it every frame
 	vector<float> getPerThreadProgress();
 
-	string getDrawableState();
+	string getDrawableState(); //rebuilt at most 10 times per second
+
+	//if set, each AssetHolder is handed to the preloader as soon as it is checked, so its
+	//ready-to-use images start decoding while the rest are still being checked
+	void setImagePreloader(AssetImagePreloader * p){preloader = p;}
+
+	//after checking each AssetHolder, re-download just the corrupt chunks of its assets that have a
+	//ChunkManifest (see AssetHolder::repairCorruptChunks())
+	void setRepairCorruptChunks(bool repair){repairCorruptChunks = repair;}
 
 	//callback
 	void onAssetCheckThreadFinished();
@@ -60,6 +141,23 @@ protected:
 	vector<AssetCheckThread*> threads;
 	vector<AssetHolder*> assetObjects;
 	ofMutex mutex;
+	AssetImagePreloader * preloader = nullptr;
+	bool repairCorruptChunks = false;
+
+	//progress
+	ofxAssets::CheckCounters counters;
+	std::atomic<bool> totalsKnown{false}; //stat pass of all threads done
+	float startTime = 0;
+	string drawableState;
+	float drawableStateTime = -1;
+
+	//auto tuning
+	AssetCheckQueue * queue = nullptr;
+	AssetCheckTuner * tuner = nullptr;
+	string tuningFile;
+	string storageDevice;
+	void saveTuning();
+	static string storageDeviceFor(const string & path);
 };
 
 #endif /* defined(__BaseApp__AssetChecker__) */
@@ -0,0 +1,231 @@
+//
+//  AssetDownloadScheduler.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetDownloadScheduler.h"
+#include "AssetHolder.h"
+#include "AssetResumableDownloader.h"
+
+
+AssetDownloadScheduler::~AssetDownloadScheduler(){
+	for(auto & s : slots){
+		delete s.downloader;
+	}
+}
+
+
+void AssetDownloadScheduler::setup(int maxConcurrentDownloads, uint64_t maxBytesPerSecond){
+
+	if(slots.size()){
+		ofLogError("AssetDownloadScheduler") << "Already setup!";
+		return;
+	}
+	limiter.setMaxBytesPerSecond(maxBytesPerSecond);
+	slots.resize(std::max(1, maxConcurrentDownloads));
+	for(auto & s : slots){
+		s.downloader = new AssetResumableDownloader();
+		s.downloader->setBandwidthLimiter(&limiter);
+	}
+}
+
+
+void AssetDownloadScheduler::setHolderPriority(AssetHolder * holder, float priority){
+	holderPriorities[holder] = priority;
+}
+
+
+vector<string> AssetDownloadScheduler::requestMissingAssets(AssetHolder * holder){
+
+	if(slots.empty()){
+		ofLogError("AssetDownloadScheduler") << "call setup() first!";
+		return vector<string>();
+	}
+
+	vector<string> urls;
+	for(auto & d : holder->getMissingAssets()){
+
+		Interest interest;
+		interest.holder = holder;
+		interest.relativePath = d.relativePath;
+		interest.destinationFolder = holder->getDirectoryForAssets();
+
+		auto it = jobs.find(d.url);
+		if(it == jobs.end()){
+			Job j;
+			j.url = d.url;
+			j.checksum = d.checksum;
+			j.checksumType = d.checksumType;
+			j.estimatedSize = estimateSize(d);
+			j.interested.push_back(interest);
+			jobs[d.url] = j;
+			queue.push_back(d.url);
+		}else{
+			bool alreadyThere = false;
+			for(auto & i : it->second.interested){
+				if(i.holder == holder) alreadyThere = true;
+			}
+			if(!alreadyThere) it->second.interested.push_back(interest);
+		}
+		urls.push_back(d.url);
+	}
+	startNextJobs();
+	return urls;
+}
+
+
+void AssetDownloadScheduler::forgetHolder(AssetHolder * holder){
+
+	for(auto it = jobs.begin(); it != jobs.end(); ){
+		auto & interested = it->second.interested;
+		interested.erase(std::remove_if(interested.begin(), interested.end(),
+										[holder](const Interest & i){ return i.holder == holder; }),
+						 interested.end());
+		auto q = std::find(queue.begin(), queue.end(), it->first);
+		if(interested.empty() && q != queue.end()){ //nobody wants it, and its not in flight
+			queue.erase(q);
+			it = jobs.erase(it);
+		}else{
+			++it;
+		}
+	}
+	holderPriorities.erase(holder);
+}
+
+
+void AssetDownloadScheduler::update(){
+	for(auto & s : slots){
+		s.downloader->update(); //finished downloads come back through onJobFinished()
+	}
+	startNextJobs();
+}
+
+
+void AssetDownloadScheduler::cancelAllDownloads(){
+
+	//queued ones are reported as canceled, in flight ones will report as they stop
+	vector<string> canceled;
+	canceled.swap(queue);
+	for(auto & url : canceled){
+		Job j = jobs[url];
+		jobs.erase(url);
+		ofxBatchDownloaderReport report;
+		ofxSimpleHttpResponse r;
+		r.url = url;
+		r.ok = false;
+		r.checksumOK = false;
+		r.reasonForStatus = "canceled";
+		r.checksumType = j.checksumType;
+		r.expectedChecksum = j.checksum;
+		report.responses.push_back(r);
+		for(auto & i : j.interested){
+			i.holder->downloadsFinished(report);
+		}
+	}
+	for(auto & s : slots){
+		s.downloader->cancelAllDownloads();
+	}
+}
+
+
+float AssetDownloadScheduler::priorityOf(const Job & j){
+	float p = std::numeric_limits<float>::lowest();
+	for(auto & i : j.interested){
+		auto it = holderPriorities.find(i.holder);
+		p = std::max(p, it != holderPriorities.end() ? it->second : 0.0f);
+	}
+	return p;
+}
+
+
+uint64_t AssetDownloadScheduler::estimateSize(const ofxAssets::Descriptor & d){
+
+	auto it = sizeHints.find(d.url);
+	if(it != sizeHints.end()) return it->second;
+	if(d.chunks.isValid()) return d.chunks.fileSize;
+
+	switch(d.type){ //rough guesses, only used for ordering
+		case ofxAssets::JSON:
+		case ofxAssets::TEXT: return 16 * 1024;
+		case ofxAssets::FONT: return 256 * 1024;
+		case ofxAssets::IMAGE: return 1024 * 1024;
+		case ofxAssets::AUDIO: return 8 * 1024 * 1024;
+		case ofxAssets::VIDEO: return 256 * 1024 * 1024;
+		default: return 4 * 1024 * 1024;
+	}
+}
+
+
+void AssetDownloadScheduler::startNextJobs(){
+
+	for(size_t s = 0; s < slots.size() && queue.size(); s++){
+
+		if(slots[s].busy) continue;
+
+		//highest priority first, smallest first among those; priorities can change at any time
+		//so we look for the best one each time, instead of keeping the queue sorted
+		size_t best = 0;
+		for(size_t i = 1; i < queue.size(); i++){
+			const Job & a = jobs[queue[i]];
+			const Job & b = jobs[queue[best]];
+			float pa = priorityOf(a);
+			float pb = priorityOf(b);
+			if(pa > pb || (pa == pb && a.estimatedSize < b.estimatedSize)){
+				best = i;
+			}
+		}
+		string url = queue[best];
+		queue.erase(queue.begin() + best);
+
+		Job & j = jobs[url];
+		j.downloadPath = j.interested.front().relativePath;
+		slots[s].busy = true;
+		numInFlight++;
+		slots[s].downloader->downloadResources(vector<string>{j.url}, vector<string>{j.checksum},
+											   vector<ofxChecksum::Type>{j.checksumType},
+											   [this, s, url](ofxBatchDownloaderReport & report){
+												   onJobFinished(s, url, report);
+											   },
+											   j.interested.front().destinationFolder);
+	}
+}
+
+
+void AssetDownloadScheduler::onJobFinished(size_t slotIndex, const string & url, ofxBatchDownloaderReport & report){
+
+	slots[slotIndex].busy = false;
+	numInFlight--;
+
+	auto it = jobs.find(url);
+	if(it == jobs.end()) return;
+	Job j = it->second;
+	jobs.erase(it);
+
+	bool ok = report.responses.size() && report.responses[0].ok;
+	const string & downloadedPath = j.downloadPath;
+
+	for(auto & i : j.interested){
+		if(ok && i.relativePath != downloadedPath){ //same url, other folder; give it its own copy
+			std::error_code err;
+			std::filesystem::path src = ofToDataPath(downloadedPath, true);
+			std::filesystem::path dst = ofToDataPath(i.relativePath, true);
+			std::filesystem::create_directories(dst.parent_path(), err);
+			std::filesystem::remove(dst, err);
+			std::filesystem::create_hard_link(src, dst, err);
+			if(err){
+				err.clear();
+				std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing, err);
+			}
+			if(err){
+				ofLogError("AssetDownloadScheduler") << "Can't copy \"" << downloadedPath << "\" to \"" << i.relativePath << "\"";
+				ofxBatchDownloaderReport failed = report;
+				failed.responses[0].ok = false;
+				failed.responses[0].reasonForStatus = err.message();
+				i.holder->downloadsFinished(failed);
+				continue;
+			}
+		}
+		i.holder->downloadsFinished(report);
+	}
+}
@@ -0,0 +1,86 @@
+//
+//  AssetDownloadScheduler.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "AssetHolderStructs.h"
+#include "AssetBandwidthLimiter.h"
+#include "ofxDownloadCentral.h"
+
+class AssetHolder;
+class AssetResumableDownloader;
+
+//One download queue for all your AssetHolders, instead of each of them calling downloadMissingAssets()
+//on its own (and getting "Already downloading data..." while a previous batch is in flight).
+//Holders can request their missing assets at any time. Urls wanted by several holders are downloaded
+//once. The queue is ordered by holder priority, then by (estimated) size, so small assets get done
+//first and content becomes usable sooner. Concurrency and total bandwidth are capped.
+//Each finished download is reported to the downloadsFinished() of every holder that asked for it.
+//Call update() from the main thread; that's where holders get notified, and where idle download
+//slots get their next job.
+
+class AssetDownloadScheduler{
+
+public:
+
+	~AssetDownloadScheduler();
+
+	void setup(int maxConcurrentDownloads = 4, uint64_t maxBytesPerSecond = 0 /*no limit*/);
+	void setMaxBytesPerSecond(uint64_t bytesPerSec){limiter.setMaxBytesPerSecond(bytesPerSec);}
+
+	void setHolderPriority(AssetHolder * holder, float priority); //higher goes first, default 0
+	//if you know it, the size of an url is used to sort it (otherwise: ChunkManifest or asset type)
+	void setSizeHint(const string & url, uint64_t numBytes){sizeHints[url] = numBytes;}
+
+	//queue whatever this holder is missing (according to its DownloadPolicy); returns urls queued
+	//for it, including the ones already queued by others
+	vector<string> requestMissingAssets(AssetHolder * holder);
+	void forgetHolder(AssetHolder * holder); //ie before deleting it; its queued downloads are dropped if nobody else wants them
+
+	void update();
+	bool isBusy(){return queue.size() || numInFlight > 0;}
+	void cancelAllDownloads();
+
+	size_t getNumQueued(){return queue.size();}
+	int getNumInFlight(){return numInFlight;}
+
+protected:
+
+	struct Interest{
+		AssetHolder * holder;
+		string relativePath; //where this holder wants the file
+		string destinationFolder;
+	};
+
+	struct Job{
+		string url;
+		string checksum;
+		ofxChecksum::Type checksumType;
+		uint64_t estimatedSize = 0;
+		vector<Interest> interested;
+		string downloadPath; //relativePath of the holder we downloaded it for
+	};
+
+	struct Slot{
+		AssetResumableDownloader * downloader = nullptr;
+		bool busy = false;
+	};
+
+	float priorityOf(const Job & j);
+	uint64_t estimateSize(const ofxAssets::Descriptor & d);
+	void startNextJobs();
+	void onJobFinished(size_t slotIndex, const string & url, ofxBatchDownloaderReport & report);
+
+	vector<Slot> slots;
+	std::unordered_map<string, Job> jobs; //by url, queued or in flight
+	vector<string> queue; //urls waiting for a slot, sorted when we pick one
+	int numInFlight = 0;
+
+	std::unordered_map<AssetHolder*, float> holderPriorities;
+	std::unordered_map<string, uint64_t> sizeHints;
+	ofxAssets::BandwidthLimiter limiter;
+};
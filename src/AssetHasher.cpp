@@ -0,0 +1,304 @@
+//
+//  AssetHasher.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetHasher.h"
+
+using namespace ofxAssets;
+
+static const uint64_t XX_PRIME_1 = 11400714785074694791ULL;
+static const uint64_t XX_PRIME_2 = 14029467366897019727ULL;
+static const uint64_t XX_PRIME_3 = 1609587929392839161ULL;
+static const uint64_t XX_PRIME_4 = 9650029242287828579ULL;
+static const uint64_t XX_PRIME_5 = 2870177450012600261ULL;
+
+static inline uint32_t rotl32(uint32_t x, int r){ return (x << r) | (x >> (32 - r)); }
+static inline uint64_t rotl64(uint64_t x, int r){ return (x << r) | (x >> (64 - r)); }
+
+static inline uint64_t readLE64(const unsigned char * p){
+	uint64_t v = 0;
+	for(int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+	return v;
+}
+
+static inline uint32_t readLE32(const unsigned char * p){
+	return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+static inline uint64_t xxRound(uint64_t acc, uint64_t input){
+	acc += input * XX_PRIME_2;
+	acc = rotl64(acc, 31);
+	return acc * XX_PRIME_1;
+}
+
+static inline uint64_t xxMergeRound(uint64_t acc, uint64_t val){
+	acc ^= xxRound(0, val);
+	return acc * XX_PRIME_1 + XX_PRIME_4;
+}
+
+
+Hasher::Hasher(ofxChecksum::Type type_){
+	type = type_;
+	reset();
+}
+
+
+void Hasher::reset(){
+	numBytes = 0;
+	blockLen = 0;
+	sha1State[0] = 0x67452301; sha1State[1] = 0xEFCDAB89; sha1State[2] = 0x98BADCFE;
+	sha1State[3] = 0x10325476; sha1State[4] = 0xC3D2E1F0;
+	const uint64_t seed = 0; //ofxChecksum uses seed 0
+	xxState[0] = seed + XX_PRIME_1 + XX_PRIME_2;
+	xxState[1] = seed + XX_PRIME_2;
+	xxState[2] = seed;
+	xxState[3] = seed - XX_PRIME_1;
+}
+
+
+size_t Hasher::blockSize() const{
+	return type == ofxChecksum::Type::SHA1 ? 64 : 32;
+}
+
+
+void Hasher::update(const char * data_, size_t len){
+
+	const unsigned char * data = (const unsigned char *)data_;
+	const size_t bs = blockSize();
+	numBytes += len;
+
+	if(blockLen > 0){ //top up the pending block first
+		size_t n = std::min(bs - blockLen, len);
+		memcpy(block + blockLen, data, n);
+		blockLen += n; data += n; len -= n;
+		if(blockLen == bs){
+			if(bs == 64) sha1Block(block); else xxBlock(block);
+			blockLen = 0;
+		}
+	}
+	while(len >= bs){
+		if(bs == 64) sha1Block(data); else xxBlock(data);
+		data += bs; len -= bs;
+	}
+	if(len > 0){
+		memcpy(block, data, len);
+		blockLen = len;
+	}
+}
+
+
+void Hasher::xxBlock(const unsigned char * b){
+	for(int i = 0; i < 4; i++){
+		xxState[i] = xxRound(xxState[i], readLE64(b + 8 * i));
+	}
+}
+
+
+void Hasher::sha1Block(const unsigned char * b){
+
+	uint32_t w[80];
+	for(int i = 0; i < 16; i++){
+		w[i] = (uint32_t(b[4*i]) << 24) | (uint32_t(b[4*i+1]) << 16) | (uint32_t(b[4*i+2]) << 8) | uint32_t(b[4*i+3]);
+	}
+	for(int i = 16; i < 80; i++){
+		w[i] = rotl32(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+	}
+
+	uint32_t a = sha1State[0], bb = sha1State[1], c = sha1State[2], d = sha1State[3], e = sha1State[4];
+	for(int i = 0; i < 80; i++){
+		uint32_t f, k;
+		if(i < 20){ f = (bb & c) | (~bb & d); k = 0x5A827999; }
+		else if(i < 40){ f = bb ^ c ^ d; k = 0x6ED9EBA1; }
+		else if(i < 60){ f = (bb & c) | (bb & d) | (c & d); k = 0x8F1BBCDC; }
+		else{ f = bb ^ c ^ d; k = 0xCA62C1D6; }
+		uint32_t t = rotl32(a, 5) + f + e + k + w[i];
+		e = d; d = c; c = rotl32(bb, 30); bb = a; a = t;
+	}
+	sha1State[0] += a; sha1State[1] += bb; sha1State[2] += c; sha1State[3] += d; sha1State[4] += e;
+}
+
+
+string Hasher::getHexDigest() const{
+
+	char hex[41];
+
+	if(type == ofxChecksum::Type::SHA1){
+
+		Hasher h = *this; //finalize a copy, so we can keep on feeding this one
+		uint64_t bitLen = numBytes * 8;
+		unsigned char pad[72];
+		size_t padLen = (h.blockLen < 56) ? (56 - h.blockLen) : (120 - h.blockLen);
+		memset(pad, 0, sizeof(pad));
+		pad[0] = 0x80;
+		for(int i = 0; i < 8; i++){
+			pad[padLen + i] = (unsigned char)(bitLen >> (56 - 8 * i));
+		}
+		h.update((const char*)pad, padLen + 8);
+		for(int i = 0; i < 5; i++){
+			snprintf(hex + 8 * i, 9, "%08x", h.sha1State[i]);
+		}
+		return string(hex, 40);
+
+	}else{
+
+		uint64_t h;
+		if(numBytes >= 32){
+			h = rotl64(xxState[0], 1) + rotl64(xxState[1], 7) + rotl64(xxState[2], 12) + rotl64(xxState[3], 18);
+			for(int i = 0; i < 4; i++) h = xxMergeRound(h, xxState[i]);
+		}else{
+			h = xxState[2] /*seed*/ + XX_PRIME_5;
+		}
+		h += numBytes;
+
+		const unsigned char * p = block;
+		size_t len = blockLen;
+		while(len >= 8){
+			h ^= xxRound(0, readLE64(p));
+			h = rotl64(h, 27) * XX_PRIME_1 + XX_PRIME_4;
+			p += 8; len -= 8;
+		}
+		if(len >= 4){
+			h ^= uint64_t(readLE32(p)) * XX_PRIME_1;
+			h = rotl64(h, 23) * XX_PRIME_2 + XX_PRIME_3;
+			p += 4; len -= 4;
+		}
+		while(len > 0){
+			h ^= (*p) * XX_PRIME_5;
+			h = rotl64(h, 11) * XX_PRIME_1;
+			p++; len--;
+		}
+		h ^= h >> 33; h *= XX_PRIME_2;
+		h ^= h >> 29; h *= XX_PRIME_3;
+		h ^= h >> 32;
+
+		snprintf(hex, sizeof(hex), "%016llx", (unsigned long long)h);
+		return string(hex);
+	}
+}
+
+
+string Hasher::getState() const{
+
+	std::ostringstream ss;
+	ss << (type == ofxChecksum::Type::SHA1 ? "sha1" : "xxhash") << " " << numBytes << " ";
+	for(int i = 0; i < 5; i++) ss << sha1State[i] << " ";
+	for(int i = 0; i < 4; i++) ss << xxState[i] << " ";
+	ss << blockLen;
+	for(size_t i = 0; i < blockLen; i++) ss << " " << (int)block[i];
+	return ss.str();
+}
+
+
+bool Hasher::setState(const string & state){
+
+	std::istringstream ss(state);
+	string typeName;
+	Hasher h(type);
+	ss >> typeName >> h.numBytes;
+	if(typeName != (type == ofxChecksum::Type::SHA1 ? "sha1" : "xxhash")) return false;
+	for(int i = 0; i < 5; i++) ss >> h.sha1State[i];
+	for(int i = 0; i < 4; i++) ss >> h.xxState[i];
+	ss >> h.blockLen;
+	if(ss.fail() || h.blockLen >= blockSize() || h.blockLen > h.numBytes) return false;
+	for(size_t i = 0; i < h.blockLen; i++){
+		int b = -1;
+		ss >> b;
+		if(b < 0 || b > 255) return false;
+		h.block[i] = (unsigned char)b;
+	}
+	if(ss.fail()) return false;
+	*this = h;
+	return true;
+}
+
+
+bool Hasher::matches(const string & expectedChecksum) const{
+	return checksumsMatch(getHexDigest(), expectedChecksum, type);
+}
+
+
+string Hasher::hashBuffer(const char * data, size_t len, ofxChecksum::Type type){
+	Hasher h(type);
+	h.update(data, len);
+	return h.getHexDigest();
+}
+
+
+bool Hasher::checksumsMatch(const string & computed, const string & expected, ofxChecksum::Type type){
+
+	if(computed.size() == 0 || expected.size() == 0) return false;
+
+	if(type != ofxChecksum::Type::SHA1){ //compare xxHash by value
+		char * end1 = nullptr; char * end2 = nullptr;
+		unsigned long long a = strtoull(computed.c_str(), &end1, 16);
+		unsigned long long b = strtoull(expected.c_str(), &end2, 16);
+		if(*end1 == '\0' && *end2 == '\0'){
+			return a == b;
+		}
+	}
+	return ofToLower(computed) == ofToLower(expected);
+}
+
+
+string Hasher::normalizedChecksum(const string & checksum, ofxChecksum::Type type){
+
+	string trimmed = ofToLower(ofTrim(checksum));
+	if(type != ofxChecksum::Type::SHA1 && trimmed.size()){ //same value, same spelling
+		char * end = nullptr;
+		unsigned long long v = strtoull(trimmed.c_str(), &end, 16);
+		if(*end == '\0'){
+			char hex[17];
+			snprintf(hex, sizeof(hex), "%016llx", v);
+			return hex;
+		}
+	}
+	return trimmed;
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
+ChunkVerifier::ChunkVerifier(ofxChecksum::Type type, const ChunkManifest & manifest_) :
+	manifest(manifest_), whole(type), chunk(type){
+}
+
+
+void ChunkVerifier::update(const char * data, size_t len){
+
+	whole.update(data, len);
+	size_t numChunks = manifest.getNumChunks();
+
+	while(len > 0){
+		if(chunkIndex >= numChunks){
+			excessBytes += len;
+			return;
+		}
+		uint64_t chunkLen = manifest.getChunkLength(chunkIndex);
+		size_t n = (size_t)std::min<uint64_t>(len, chunkLen - chunkBytes);
+		chunk.update(data, n);
+		chunkBytes += n; data += n; len -= n;
+		if(chunkBytes == chunkLen){
+			if(!chunk.matches(manifest.chunkChecksums[chunkIndex])){
+				corrupt.push_back(chunkIndex);
+			}
+			chunkIndex++;
+			chunkBytes = 0;
+			chunk.reset();
+		}
+	}
+}
+
+
+void ChunkVerifier::finish(){
+
+	size_t numChunks = manifest.getNumChunks();
+	for(size_t i = chunkIndex; i < numChunks; i++){
+		corrupt.push_back(i);
+	}
+	chunkIndex = numChunks;
+	//file too long; re-fetching the last chunk will get the file truncated to the right size
+	if(excessBytes > 0 && numChunks > 0 && (corrupt.empty() || corrupt.back() != numChunks - 1)){
+		corrupt.push_back(numChunks - 1);
+	}
+}
@@ -0,0 +1,85 @@
+//
+//  AssetHasher.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxChecksum.h"
+#include "AssetHolderStructs.h"
+
+//streaming SHA1 / xxHash64, so we can hash bytes we already have in memory (or are reading
+//for some other reason) instead of making ofxChecksum read the file from disk again.
+namespace ofxAssets{
+
+	class Hasher{
+
+	public:
+
+		Hasher(ofxChecksum::Type type = ofxChecksum::Type::SHA1);
+
+		void reset();
+		void update(const char * data, size_t len);
+
+		//hex string, same format as ofxChecksum. Doesnt "close" the hasher, you can keep feeding it
+		string getHexDigest() const;
+		bool matches(const string & expectedChecksum) const;
+
+		uint64_t getNumBytesHashed() const {return numBytes;}
+		ofxChecksum::Type getType() const {return type;}
+
+		//snapshot of the hashing state (as text) so an interrupted hash can be picked up later
+		string getState() const;
+		bool setState(const string & state); //false if state is bogus or for another checksum type
+
+		static string hashBuffer(const char * data, size_t len, ofxChecksum::Type type);
+
+		//sha1 compares case insensitive, xxHash compares by value (leading zeros / case dont matter)
+		static bool checksumsMatch(const string & computed, const string & expected, ofxChecksum::Type type);
+
+		//one spelling per value, so checksums that match also compare equal as strings (ie to name files after them)
+		static string normalizedChecksum(const string & checksum, ofxChecksum::Type type);
+
+	protected:
+
+		ofxChecksum::Type type;
+		uint64_t numBytes;
+
+		unsigned char block[64]; //pending bytes that dont fill a whole block yet
+		size_t blockLen;
+
+		uint32_t sha1State[5];
+		uint64_t xxState[4];
+
+		void sha1Block(const unsigned char * b);
+		void xxBlock(const unsigned char * b);
+		size_t blockSize() const;
+	};
+
+	//feed it a file's bytes in order, it hashes the whole file and each of the
+	//manifest's chunks in the same pass
+	class ChunkVerifier{
+
+	public:
+
+		ChunkVerifier(ofxChecksum::Type type, const ChunkManifest & manifest);
+
+		void update(const char * data, size_t len);
+		void finish(); //chunks we never got all the bytes for are corrupt too
+
+		string getHexDigest() const {return whole.getHexDigest();}
+		const vector<size_t> & getCorruptChunks() const {return corrupt;}
+
+	protected:
+
+		const ChunkManifest & manifest;
+		Hasher whole;
+		Hasher chunk;
+		size_t chunkIndex = 0;
+		uint64_t chunkBytes = 0;
+		uint64_t excessBytes = 0; //file is longer than the manifest says
+		vector<size_t> corrupt;
+	};
+}
@@ -0,0 +1,419 @@
+//
+//  AssetHeaderProbe.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetHeaderProbe.h"
+
+using namespace ofxAssets;
+
+static inline uint16_t readBE16(const unsigned char * p){ return (uint16_t(p[0]) << 8) | p[1]; }
+static inline uint32_t readBE32(const unsigned char * p){ return (uint32_t(readBE16(p)) << 16) | readBE16(p + 2); }
+static inline uint64_t readBE64(const unsigned char * p){ return (uint64_t(readBE32(p)) << 32) | readBE32(p + 4); }
+static inline uint16_t readLE16(const unsigned char * p){ return uint16_t(p[0]) | (uint16_t(p[1]) << 8); }
+static inline uint32_t readLE32(const unsigned char * p){ return uint32_t(readLE16(p)) | (uint32_t(readLE16(p + 2)) << 16); }
+static inline bool isFourCC(const unsigned char * p, const char * cc){ return memcmp(p, cc, 4) == 0; }
+
+static const uint64_t maxMoovSize = 64 * 1024 * 1024; //bigger than any sane moov, we won't buffer more
+
+
+void HeaderProbe::update(const char * data_, size_t len){
+
+	const unsigned char * data = (const unsigned char *)data_;
+
+	while(len > 0 && !done){
+		if(pos < wantOffset){ //not interested in these
+			uint64_t skip = std::min<uint64_t>(wantOffset - pos, len);
+			data += skip; len -= skip; pos += skip;
+			continue;
+		}
+		if(pos != wantOffset + buffer.size()){ //seeked past bytes we wanted
+			done = true;
+			return;
+		}
+		size_t n = (size_t)std::min<uint64_t>(wantLen - buffer.size(), len);
+		buffer.insert(buffer.end(), data, data + n);
+		data += n; len -= n; pos += n;
+		if(buffer.size() >= wantLen){
+			parse();
+		}
+	}
+}
+
+
+void HeaderProbe::seek(uint64_t offset){
+	if(offset > pos) pos = offset;
+}
+
+
+void HeaderProbe::finish(){
+	if(!done && state == DETECT && buffer.size() > 0){ //short file, make do with what we have
+		wantLen = buffer.size();
+		detect();
+	}
+	done = true;
+}
+
+
+void HeaderProbe::want(State s, uint64_t offset, uint64_t len){
+
+	if(offset < pos){ //some (or all) of it went by already, it better be in the buffer
+		if(offset < wantOffset || offset > wantOffset + buffer.size()){
+			done = true;
+			return;
+		}
+		buffer.erase(buffer.begin(), buffer.begin() + (size_t)(offset - wantOffset));
+	}else{
+		buffer.clear();
+	}
+	state = s;
+	wantOffset = offset;
+	wantLen = len;
+	if(buffer.size() >= wantLen){
+		parse();
+	}
+}
+
+
+void HeaderProbe::parse(){
+
+	const unsigned char * b = buffer.data();
+	uint64_t at = wantOffset;
+
+	switch(state){
+
+		case DETECT:
+			detect();
+			break;
+
+		case JPEG_MARKER:{
+			if(b[0] != 0xFF){ done = true; break; }
+			uint8_t m = b[1];
+			if(m == 0xFF){ want(JPEG_MARKER, at + 1, 4); break; } //fill byte
+			if(m == 0xD8 || m == 0x01 || (m >= 0xD0 && m <= 0xD7)){ want(JPEG_MARKER, at + 2, 4); break; } //no length
+			if(m == 0xD9 || m == 0xDA){ done = true; break; } //image data before any SOF
+			bool isSOF = m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+			if(isSOF) want(JPEG_SOF, at + 4, 5);
+			else want(JPEG_MARKER, at + 2 + readBE16(b + 2), 4);
+		}break;
+
+		case JPEG_SOF:
+			height = readBE16(b + 1);
+			width = readBE16(b + 3);
+			done = true;
+			break;
+
+		case WAV_CHUNK:{
+			uint32_t size = readLE32(b + 4);
+			if(isFourCC(b, "fmt ") && size >= 16) want(WAV_FMT, at + 8, 16);
+			else if(isFourCC(b, "data")) done = true; //no fmt before the samples
+			else want(WAV_CHUNK, at + 8 + size + (size & 1), 8);
+		}break;
+
+		case WAV_FMT:{
+			uint16_t tag = readLE16(b);
+			uint16_t bits = readLE16(b + 14);
+			if(tag == 1 || tag == 0xFFFE) codec = bits == 8 ? "pcm_u8" : "pcm_s" + ofToString(bits) + "le";
+			else if(tag == 3) codec = "pcm_f" + ofToString(bits) + "le";
+			else if(tag == 6) codec = "pcm_alaw";
+			else if(tag == 7) codec = "pcm_mulaw";
+			else if(tag == 0x55) codec = "mp3";
+			else codec = "wav_" + ofToString(tag);
+			done = true;
+		}break;
+
+		case BOX_HEADER:
+		case BOX_HEADER_64:{
+			uint64_t size = readBE32(b);
+			uint64_t headerLen = 8;
+			if(size == 1){
+				if(state == BOX_HEADER){ want(BOX_HEADER_64, at, 16); break; }
+				size = readBE64(b + 8);
+				headerLen = 16;
+			}
+			if(size < headerLen){ done = true; break; } //0 is "up to the end of file", nothing after it
+			if(isFourCC(b + 4, "moov")){
+				if(size > maxMoovSize){ done = true; break; }
+				want(MOOV, at, size);
+			}else{
+				want(BOX_HEADER, at + size, 8);
+			}
+		}break;
+
+		case MOOV:
+			{
+				size_t headerLen = readBE32(b) == 1 ? 16 : 8;
+				parseMoov(b + headerLen, (size_t)wantLen - headerLen);
+			}
+			done = true;
+			break;
+	}
+}
+
+
+void HeaderProbe::detect(){
+
+	const unsigned char * b = buffer.data();
+	size_t len = std::min<size_t>(buffer.size(), wantLen);
+
+	if(len >= 24 && memcmp(b, "\x89PNG\r\n\x1a\n", 8) == 0 && isFourCC(b + 12, "IHDR")){
+		format = PNG;
+		width = readBE32(b + 16);
+		height = readBE32(b + 20);
+		done = true;
+	}else if(len >= 3 && b[0] == 0xFF && b[1] == 0xD8 && b[2] == 0xFF){
+		format = JPEG;
+		want(JPEG_MARKER, 2, 4);
+	}else if(len >= 10 && (memcmp(b, "GIF87a", 6) == 0 || memcmp(b, "GIF89a", 6) == 0)){
+		format = GIF;
+		width = readLE16(b + 6);
+		height = readLE16(b + 8);
+		done = true;
+	}else if(len >= 26 && b[0] == 'B' && b[1] == 'M'){
+		uint32_t dibSize = readLE32(b + 14);
+		if(dibSize == 12){ //OS/2
+			format = BMP;
+			width = readLE16(b + 18);
+			height = readLE16(b + 20);
+		}else if(dibSize >= 40 && dibSize <= 124){
+			format = BMP;
+			width = (int32_t)readLE32(b + 18);
+			height = std::abs((int32_t)readLE32(b + 22)); //negative for top down
+		}
+		done = true;
+	}else if(len >= 12 && isFourCC(b, "RIFF") && isFourCC(b + 8, "WAVE")){
+		format = WAV;
+		want(WAV_CHUNK, 12, 8);
+	}else if(len >= 8 && (isFourCC(b + 4, "ftyp") || isFourCC(b + 4, "moov") || isFourCC(b + 4, "mdat") ||
+						  isFourCC(b + 4, "wide") || isFourCC(b + 4, "free") || isFourCC(b + 4, "skip"))){
+		format = ISO_BMFF;
+		want(BOX_HEADER, 0, 8);
+	}else{
+		detectByMagic(b, len);
+		done = true;
+	}
+}
+
+
+void HeaderProbe::detectByMagic(const unsigned char * b, size_t len){
+
+	if(len >= 4 && (memcmp(b, "II*\0", 4) == 0 || memcmp(b, "MM\0*", 4) == 0)){
+		format = TIFF;
+	}else if(len >= 12 && isFourCC(b, "RIFF") && isFourCC(b + 8, "WEBP")){
+		format = WEBP;
+	}else if(len >= 12 && isFourCC(b, "RIFF") && isFourCC(b + 8, "AVI ")){
+		format = AVI;
+	}else if(len >= 12 && isFourCC(b, "FORM") && (isFourCC(b + 8, "AIFF") || isFourCC(b + 8, "AIFC"))){
+		format = AIFF;
+	}else if(len >= 4 && isFourCC(b, "fLaC")){
+		format = FLAC;
+		codec = "flac";
+	}else if(len >= 3 && (memcmp(b, "ID3", 3) == 0 || (b[0] == 0xFF && (b[1] & 0xE6) == 0xE2))){ //tag, or mpeg layer 3 frame sync
+		format = MP3;
+		codec = "mp3";
+	}else if(len >= 4 && isFourCC(b, "OggS")){
+		format = OGG; //the first packet (after a 27 byte page header and a 1 byte segment table) tells the codec
+		if(len >= 32 && memcmp(b + 28, "\x01vor", 4) == 0) codec = "vorbis";
+		else if(len >= 32 && isFourCC(b + 28, "Opus")) codec = "opus";
+		else if(len >= 32 && memcmp(b + 28, "\x80the", 4) == 0) codec = "theora";
+	}else if(len >= 4 && b[0] == 0x1A && b[1] == 0x45 && b[2] == 0xDF && b[3] == 0xA3){
+		format = MATROSKA;
+	}else if(len >= 4 && (memcmp(b, "\0\x01\0\0", 4) == 0 || isFourCC(b, "OTTO") || isFourCC(b, "true") || isFourCC(b, "ttcf"))){
+		format = FONT;
+	}else{
+		size_t i = (len >= 3 && b[0] == 0xEF && b[1] == 0xBB && b[2] == 0xBF) ? 3 : 0; //utf8 BOM
+		while(i < len && (b[i] == ' ' || b[i] == '\t' || b[i] == '\r' || b[i] == '\n')) i++;
+		if(i < len && (b[i] == '{' || b[i] == '[')) format = JSON_TEXT;
+	}
+}
+
+
+ofxAssets::Type HeaderProbe::getType() const{
+	switch(format){
+		case PNG: case JPEG: case GIF: case BMP: case TIFF: case WEBP:
+			return ofxAssets::IMAGE;
+		case WAV: case MP3: case FLAC: case AIFF:
+			return ofxAssets::AUDIO;
+		case OGG:
+			if(codec == "theora") return ofxAssets::VIDEO;
+			return codec.size() ? ofxAssets::AUDIO : ofxAssets::TYPE_UNKNOWN;
+		case ISO_BMFF: //a video track has a size, audio only files just have a codec
+			if(width > 0 && height > 0) return ofxAssets::VIDEO;
+			return codec.size() ? ofxAssets::AUDIO : ofxAssets::TYPE_UNKNOWN;
+		case MATROSKA: case AVI:
+			return ofxAssets::VIDEO;
+		case FONT:
+			return ofxAssets::FONT;
+		case JSON_TEXT:
+			return ofxAssets::JSON;
+		default:
+			return ofxAssets::TYPE_UNKNOWN;
+	}
+}
+
+
+//calls onBox(type, payload, payloadLen) for each box in data
+static void forEachBox(const unsigned char * data, size_t len,
+					   std::function<void(const unsigned char *, const unsigned char *, size_t)> onBox){
+	size_t at = 0;
+	while(at + 8 <= len){
+		uint64_t size = readBE32(data + at);
+		size_t headerLen = 8;
+		if(size == 1){
+			if(at + 16 > len) return;
+			size = readBE64(data + at + 8);
+			headerLen = 16;
+		}else if(size == 0){
+			size = len - at;
+		}
+		if(size < headerLen || size > len - at) return;
+		onBox(data + at + 4, data + at + headerLen, (size_t)(size - headerLen));
+		at += (size_t)size;
+	}
+}
+
+
+static string codecFromFourCC(const unsigned char * cc){
+	string f((const char *)cc, 4);
+	if(f == "avc1" || f == "avc3") return "h264";
+	if(f == "hvc1" || f == "hev1") return "hevc";
+	if(f == "mp4v") return "mpeg4";
+	if(f == "av01") return "av1";
+	if(f == "vp09") return "vp9";
+	if(f == "apch" || f == "apcn" || f == "apcs" || f == "apco" || f == "ap4h" || f == "ap4x") return "prores";
+	if(f == "jpeg") return "mjpeg";
+	if(f == "mp4a") return "aac";
+	if(f == "ac-3") return "ac3";
+	if(f == "ec-3") return "eac3";
+	if(f == "Opus") return "opus";
+	if(f == "fLaC") return "flac";
+	if(f == "lpcm" || f == "sowt" || f == "twos" || f == "in24" || f == "fl32") return "pcm";
+	return ofTrim(f);
+}
+
+
+void HeaderProbe::parseMoov(const unsigned char * data, size_t len){
+
+	struct Track{
+		string handler;
+		int width = 0;
+		int height = 0;
+		string codec;
+	};
+	vector<Track> tracks;
+
+	forEachBox(data, len, [&](const unsigned char * type, const unsigned char * p, size_t n){
+		if(!isFourCC(type, "trak")) return;
+		Track t;
+		forEachBox(p, n, [&](const unsigned char * type, const unsigned char * p, size_t n){
+			if(isFourCC(type, "tkhd") && n >= 84){ //width and height are the last 8 bytes, 16.16 fixed point
+				t.width = readBE32(p + n - 8) >> 16;
+				t.height = readBE32(p + n - 4) >> 16;
+			}else if(isFourCC(type, "mdia")){
+				forEachBox(p, n, [&](const unsigned char * type, const unsigned char * p, size_t n){
+					if(isFourCC(type, "hdlr") && n >= 12){
+						t.handler = string((const char *)p + 8, 4);
+					}else if(isFourCC(type, "minf")){
+						forEachBox(p, n, [&](const unsigned char * type, const unsigned char * p, size_t n){
+							if(!isFourCC(type, "stbl")) return;
+							forEachBox(p, n, [&](const unsigned char * type, const unsigned char * p, size_t n){
+								if(isFourCC(type, "stsd") && n >= 16){ //first sample entry's type is the codec
+									t.codec = codecFromFourCC(p + 12);
+								}
+							});
+						});
+					}
+				});
+			}
+		});
+		tracks.push_back(t);
+	});
+
+	for(auto & t : tracks){ //video first, then audio only files
+		if(t.handler == "vide"){
+			width = t.width;
+			height = t.height;
+			codec = t.codec;
+			return;
+		}
+	}
+	for(auto & t : tracks){
+		if(t.handler == "soun"){
+			codec = t.codec;
+			return;
+		}
+	}
+}
+
+
+string HeaderProbe::toString(Format f){
+	switch(f){
+		case PNG: return "png";
+		case JPEG: return "jpeg";
+		case GIF: return "gif";
+		case BMP: return "bmp";
+		case WAV: return "wav";
+		case ISO_BMFF: return "mp4/mov";
+		case TIFF: return "tiff";
+		case WEBP: return "webp";
+		case MP3: return "mp3";
+		case FLAC: return "flac";
+		case AIFF: return "aiff";
+		case OGG: return "ogg";
+		case MATROSKA: return "mkv/webm";
+		case AVI: return "avi";
+		case FONT: return "font";
+		case JSON_TEXT: return "json";
+		default: return "unknown";
+	}
+}
+
+
+HeaderProbe::Format HeaderProbe::formatForExtension(const string & extension){
+	string e = ofToLower(extension);
+	if(e == "png") return PNG;
+	if(e == "jpg" || e == "jpeg" || e == "jpe") return JPEG;
+	if(e == "gif") return GIF;
+	if(e == "bmp") return BMP;
+	if(e == "wav" || e == "wave") return WAV;
+	if(e == "mp4" || e == "m4v" || e == "m4a" || e == "mov" || e == "qt" || e == "3gp") return ISO_BMFF;
+	if(e == "tif" || e == "tiff") return TIFF;
+	if(e == "webp") return WEBP;
+	if(e == "mp3") return MP3;
+	if(e == "flac") return FLAC;
+	if(e == "aif" || e == "aiff") return AIFF;
+	if(e == "ogg" || e == "oga" || e == "ogv" || e == "opus") return OGG;
+	if(e == "mkv" || e == "webm") return MATROSKA;
+	if(e == "avi") return AVI;
+	if(e == "ttf" || e == "otf" || e == "ttc") return FONT;
+	if(e == "json") return JSON_TEXT;
+	return UNKNOWN_FORMAT;
+}
+
+
+bool HeaderProbe::probeFile(const string & path, HeaderProbe & probe){
+
+	std::ifstream file(ofToDataPath(path, true), std::ios::in | std::ios::binary);
+	if(!file.is_open()) return false;
+
+	vector<char> block(64 * 1024);
+	uint64_t at = 0;
+	uint64_t totalRead = 0;
+	while(!probe.isDone() && totalRead < maxMoovSize + block.size()){
+		if(probe.getSkipTo() > at){ //ie over an mdat
+			at = probe.getSkipTo();
+			file.clear();
+			file.seekg(at);
+			probe.seek(at);
+		}
+		file.read(block.data(), block.size());
+		std::streamsize n = file.gcount();
+		if(n <= 0) break;
+		probe.update(block.data(), (size_t)n);
+		at += n;
+		totalRead += n;
+	}
+	probe.finish();
+	return probe.getFormat() != UNKNOWN_FORMAT;
+}
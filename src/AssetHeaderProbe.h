@@ -0,0 +1,87 @@
+//
+//  AssetHeaderProbe.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "AssetHolderStructs.h"
+
+//reads just enough of a file's headers (PNG IHDR, JPEG SOF, GIF / BMP headers, WAV fmt, MP4 / MOV moov)
+//to tell its format, size and codec, without a decoder. Feed it the bytes you are reading anyway (ie
+//to hash them) or let probeFile() read the few it needs. Other formats are only told apart by their
+//magic bytes (no size / codec).
+namespace ofxAssets{
+
+	class HeaderProbe{
+
+	public:
+
+		enum Format{
+			UNKNOWN_FORMAT,
+			PNG,
+			JPEG,
+			GIF,
+			BMP,
+			WAV,
+			ISO_BMFF, //mp4, mov, m4a...
+			//magic bytes only
+			TIFF,
+			WEBP,
+			MP3,
+			FLAC,
+			AIFF,
+			OGG,
+			MATROSKA, //mkv, webm
+			AVI,
+			FONT, //ttf, otf, ttc
+			JSON_TEXT //starts with { or [
+		};
+
+		//feed the file in order, from its first byte (or from getSkipTo() after a seek()).
+		//Extra bytes are ignored, stop feeding once isDone().
+		void update(const char * data, size_t len);
+		void seek(uint64_t offset); //you jumped ahead, next update() starts at offset
+		void finish(); //end of file
+
+		bool isDone() const {return done;}
+		bool hasStarted() const {return pos > 0;}
+		uint64_t getSkipTo() const {return wantOffset;} //next byte we care about, when reading just for the probe
+
+		Format getFormat() const {return format;}
+		int getWidth() const {return width;}
+		int getHeight() const {return height;}
+		const string & getCodec() const {return codec;} //movies / audio only; ie "h264", "aac", "pcm_s16le"
+		ofxAssets::Type getType() const; //what the contents say; TYPE_UNKNOWN if they don't say
+
+		static string toString(Format f);
+		static Format formatForExtension(const string & extension); //UNKNOWN_FORMAT if we don't probe it
+
+		//reads only what the probe needs, seeking over the rest (ie the mdat of an mp4)
+		static bool probeFile(const string & path, HeaderProbe & probe);
+
+	protected:
+
+		enum State{DETECT, JPEG_MARKER, JPEG_SOF, WAV_CHUNK, WAV_FMT, BOX_HEADER, BOX_HEADER_64, MOOV};
+
+		Format format = UNKNOWN_FORMAT;
+		int width = 0;
+		int height = 0;
+		string codec;
+
+		bool done = false;
+		uint64_t pos = 0; //file offset of the next byte fed to us
+		State state = DETECT;
+		uint64_t wantOffset = 0; //we are collecting [wantOffset, wantOffset + wantLen) into buffer
+		uint64_t wantLen = 32; //enough to tell all formats apart
+		vector<unsigned char> buffer;
+
+		void want(State s, uint64_t offset, uint64_t len);
+		void parse(); //buffer is complete
+		void detect();
+		void detectByMagic(const unsigned char * b, size_t len);
+		void parseMoov(const unsigned char * data, size_t len);
+	};
+}
@@ -9,6 +9,9 @@
 #include "AssetHolder.h"
 #include "ofxThreadSafeLog.h"
 #include "AssetHolderStructs.h"
+#include "AssetHasher.h"
+#include "AssetHttpRange.h"
+#include "AssetResumableDownloader.h"
 
 using namespace ofxAssets;
 using namespace std;
@@ -19,6 +22,60 @@ ofxAssets::Descriptor AssetHolder::emptyAsset;
 ofxAssets::UserInfo AssetHolder::emptyUserInfo;
 int AssetHolder::minimumFileSize = 1024;
 ofMutex AssetHolder::assetMutex;
+bool AssetHolder::retainVerifiedBytes = false;
+bool AssetHolder::probeHeaders = false;
+bool AssetHolder::overwriteProbedSpecs = false;
+bool AssetHolder::sniffTypes = false;
+bool AssetHolder::useArena = false;
+size_t AssetHolder::arenaInitialBytes = 64 * 1024;
+ofxAssets::BytePool AssetHolder::verifiedBytes;
+
+#if defined(OFX_ASSETS_ARENA)
+
+AssetHolder::AssetHolder() :
+	arena(useArena ? new ofxAssets::TableArena(arenaInitialBytes) : nullptr),
+	assetAddOrder(memoryResource()),
+	assets(memoryResource()){
+	isSetup = false;
+	isDownloadingData = false;
+}
+
+
+std::pmr::memory_resource * AssetHolder::memoryResource(){
+	if(arena) return arena.get();
+	return std::pmr::get_default_resource();
+}
+
+
+void AssetHolder::setArenaAllocation(bool enabled, size_t initialBytes){
+	useArena = enabled;
+	arenaInitialBytes = initialBytes;
+}
+
+
+bool AssetHolder::isArenaAvailable(){
+	return true;
+}
+
+
+bool AssetHolder::usesArena() const{
+	return arena != nullptr;
+}
+
+
+void AssetHolder::resetAssetTables(){
+	if(arena){
+		auto oldBlocks = arena->startOver(); //the empty tables get fresh blocks
+		assets = AssetMap(arena.get()); //same arena, so these just take over the empties
+		assetAddOrder = AssetOrderMap(arena.get());
+		return; //old blocks freed here, nothing points into them anymore
+	}
+	//swap with empties so the memory is actually given back
+	AssetMap(memoryResource()).swap(assets);
+	AssetOrderMap(memoryResource()).swap(assetAddOrder);
+}
+
+#else
 
 AssetHolder::AssetHolder(){
 	isSetup = false;
@@ -26,12 +83,40 @@ AssetHolder::AssetHolder(){
 }
 
 
+void AssetHolder::setArenaAllocation(bool enabled, size_t /*initialBytes*/){
+	if(enabled){
+		ofLogError("AssetHolder") << "Arena allocation not available! build ofxAssets with OFX_ASSETS_ARENA defined";
+	}
+}
+
+
+bool AssetHolder::isArenaAvailable(){
+	return false;
+}
+
+
+bool AssetHolder::usesArena() const{
+	return false;
+}
+
+
+void AssetHolder::resetAssetTables(){
+	//swap with empties so the memory is actually given back
+	AssetMap().swap(assets);
+	AssetOrderMap().swap(assetAddOrder);
+}
+
+#endif
+
+
 void AssetHolder::setup(const string& directoryForAssets_, const ofxAssets::UsagePolicy & assetOkPolicy_,
 						const ofxAssets::DownloadPolicy & downloadPolicy_){
 	isSetup = true;
 	directoryForAssets = ofFilePath::addTrailingSlash(directoryForAssets_);
 	assetOkPolicy = assetOkPolicy_;
 	downloadPolicy = downloadPolicy_;
+	compiledPolicy = ofxAssets::CompiledPolicy::compile(assetOkPolicy, downloadPolicy);
+	packedStatusDirty = true;
 
 	assetMutex.lock(); //ofSetLogLevel is not thread safe!
 //	oldSimpleHttpLevel = ofGetLogLevel("ofxSimpleHttp");
@@ -50,12 +135,13 @@ string AssetHolder::addRemoteAsset(const string& url,
 								   ofxAssets::Type type){
 
 	ASSET_HOLDER_SETUP_CHECK;
+	ensureResident();
 
 	ofxAssets::Descriptor ad;
 	ad.fileName = ofFilePath::getFileName(url);
 	ad.relativePath = ofToDataPath(directoryForAssets + ad.fileName, false);
 
-	unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.find(ad.relativePath);
+	AssetMap::iterator it = assets.find(ad.relativePath);
 	if(it == assets.end()){ //we dont have this one
 		ad.location = REMOTE;
 		ad.extension = ofFilePath::getFileExt(url);
@@ -71,6 +157,8 @@ string AssetHolder::addRemoteAsset(const string& url,
 		if(checksum.size()) ad.status.checksumSupplied = true;
 		assetAddOrder[assetAddOrder.size()] = ad.relativePath;
 		assets[ad.relativePath] = ad;
+		packedStatusDirty = true;
+		variantsDirty = true;
 		for(auto & tag : tags){
 			string objectID = ad.relativePath; //assets inside an AssetHodler are indexed by they relative path
 			this->tags.addTagForObject(objectID, Tag<TagCategory>(tag, CATEGORY));
@@ -89,11 +177,12 @@ string AssetHolder::addLocalAsset(const string& localPath,
 								  ){
 
 	ASSET_HOLDER_SETUP_CHECK;
+	ensureResident();
 
 	ofxAssets::Descriptor ad;
 	ad.relativePath = ofToDataPath(localPath, false);
 
-	unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.find(ad.relativePath);
+	AssetMap::iterator it = assets.find(ad.relativePath);
 	if(it == assets.end()){ //we dont have this one
 		ad.location = LOCAL;
 		ad.extension = ofFilePath::getFileExt(localPath);
@@ -106,6 +195,8 @@ string AssetHolder::addLocalAsset(const string& localPath,
 		ad.fileName = ofFilePath::getFileName(localPath);
 		assetAddOrder[assetAddOrder.size()] = ad.relativePath;
 		assets[ad.relativePath] = ad;
+		packedStatusDirty = true;
+		variantsDirty = true;
 
 		for(auto & tag : tags){
 			string objectID = ad.relativePath; //assets inside an AssetHodler are indexed by they relative path
@@ -120,35 +211,79 @@ string AssetHolder::addLocalAsset(const string& localPath,
 
 
 bool AssetHolder::areAllAssetsOK(){
-	int numOK = 0;
-	unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.begin();
-	while( it != assets.end()){
-		if (isReadyToUse(it->second)){
-			numOK++;
+	updatePackedStatus();
+	if(numUncheckedAssets){
+		ofLogError("AssetHolder") << "cant decide wether to USE or not - havent checked for local files yet!";
+	}
+	size_t numOK = compiledPolicy.countReady(packedStatus.data(), packedStatus.size());
+	return numOK == packedStatus.size();
+}
+
+bool AssetHolder::isAssetReadyToUse(const string & relativePath){
+	ensureResident();
+	auto it = assets.find(relativePath);
+	if(it != assets.end()){
+		return isReadyToUse(it->second);
+	}
+	return false;
+}
+
+void AssetHolder::markAssetAsMissing(const string & relativePath){
+	ensureResident();
+	auto it = assets.find(relativePath);
+	if(it != assets.end()){
+		ofxAssets::LocalAssetStatus & s = it->second.status;
+		s.checked = true;
+		s.localFileExists = false;
+		s.localFileChecksumChecked = s.checksumMatch = s.fileTooSmall = false;
+		s.downloaded = s.downloadOK = false;
+		s.corruptChunks.clear();
+		verifiedBytes.release(relativePath);
+		packedStatusDirty = true;
+	}
+}
+
+void AssetHolder::markAssetAsCorrupt(const string & relativePath, const vector<size_t> & corruptChunks){
+	ensureResident();
+	auto it = assets.find(relativePath);
+	if(it != assets.end()){
+		ofxAssets::LocalAssetStatus & s = it->second.status;
+		s.checked = true;
+		s.localFileChecksumChecked = true;
+		s.checksumMatch = false;
+		s.corruptChunks = corruptChunks;
+		verifiedBytes.release(relativePath);
+		if(contentAddressed && it->second.hasChecksum()){ //its blob, if it's linked to one
+			std::unique_lock<std::mutex> lock(blobMutex);
+			verifiedBlobs.erase(blobPathFor(it->second));
 		}
-		++it;
+		packedStatusDirty = true;
 	}
-	return numOK == assets.size();
 }
 
 vector<ofxAssets::Descriptor>
 AssetHolder::getBrokenAssets(){
+	updatePackedStatus();
+	if(numUncheckedAssets){
+		ofLogError("AssetHolder") << "cant decide wether to USE or not - havent checked for local files yet!";
+	}
 	vector<ofxAssets::Descriptor> broken;
-	unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.begin();
-	while( it != assets.end()){
-		if (!isReadyToUse(it->second)){
-			broken.push_back(it->second);
+	for(size_t i = 0; i < packedStatus.size(); i++){
+		if(!compiledPolicy.isReadyToUse(packedStatus[i])){
+			ensureResident(); //only if we have anything to report
+			broken.push_back(assets[assetAddOrder[i]]);
 		}
-		++it;
 	}
 	return broken;
 }
 
 ofxAssets::Stats AssetHolder::getAssetStats(){
 
+	if(pagedOut) return pagedOutStats;
+
 	ofxAssets::Stats s;
 	s.numAssets = assets.size();
-	unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.begin();
+	AssetMap::iterator it = assets.begin();
 	while(it != assets.end()){
 		ofxAssets::Descriptor & ad = it->second;
 		if(ad.status.checked){
@@ -168,6 +303,7 @@ ofxAssets::Stats AssetHolder::getAssetStats(){
 
 void AssetHolder::downloadsFinished(ofxBatchDownloaderReport & report){
 
+	ensureResident();
 	int n = report.responses.size();
 	for(int i = 0; i < n; i++){
 
@@ -197,49 +333,108 @@ void AssetHolder::downloadsFinished(ofxBatchDownloaderReport & report){
 				ofLogError("AssetHolder") << "Asset downloaded but checksum type mismatch! Make sure checksum types match!";
 				d.status.checksumMatch = false;
 			}
+			if(contentAddressed && d.status.checksumMatch){
+				adoptIntoContentStore(d);
+			}
 		}else{
 			ofLogError("AssetHolder") << "Asset downloaded but I dont know about it !? " << r.url;
 		}
 	}
+	if(contentAddressed){
+		linkDuplicatesFromContentStore();
+	}
 //	ofSetLogLevel("ofxBatchDownloader", oldBatchDownloaderLevel);
 //	ofSetLogLevel("ofxSimpleHttp", oldSimpleHttpLevel);
 }
 
 
-void AssetHolder::updateLocalAssetsStatus(){
+void AssetHolder::updateLocalAssetsStatus(ofxAssets::CheckCounters * counters){
 
-	unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.begin();
+	ensureResident();
+	invalidatePacks();
+	AssetMap::iterator it = assets.begin();
 
 	while( it != assets.end()){
-		checkLocalAssetStatus(it->second);
+		checkLocalAssetStatus(it->second, counters);
 		++it;
 	}
+	packedStatusDirty = true;
+	updatePackedStatus();
+}
+
+
+void AssetHolder::addToCheckTotals(ofxAssets::CheckCounters * counters){
+
+	ensureResident();
+	std::error_code err;
+	for(auto & it : assets){
+		ofxAssets::Descriptor & d = it.second;
+		counters->totalFiles++;
+		if(d.isPacked()){ //the whole pack is read when checking
+			auto pack = AssetPack::get(d.packFile);
+			const AssetPack::Entry * e = pack ? pack->getEntry(d.packEntry) : nullptr;
+			if(e) counters->totalBytes += e->size;
+			continue;
+		}
+		uint64_t size = std::filesystem::file_size(ofToDataPath(d.relativePath, true), err);
+		if(!err && (d.hasChecksum() || shouldRetainBytes(d, size))){ //what will be read
+			counters->totalBytes += size;
+		}
+	}
 }
 
 
-void AssetHolder::checkLocalAssetStatus(ofxAssets::Descriptor & d){
+void AssetHolder::checkLocalAssetStatus(ofxAssets::Descriptor & d, ofxAssets::CheckCounters * counters){
 
 	if(d.relativePath.size() == 0){
 		ofLogError("AssetHolder") << "Asset with no 'relativePath'; cant checkLocalAssetStatus!";
 		return;
 	}
+	packedStatusDirty = true;
+
+	//forget results of previous checks
+	d.status.checksumMatch = d.status.fileTooSmall = d.status.localFileChecksumChecked = false;
+	d.status.corruptChunks.clear();
+	d.status.headerMismatch = false;
+	verifiedBytes.release(d.relativePath); //whatever we kept is stale until this check says otherwise
+
+	if(d.isPacked()){
+		checkPackedAssetStatus(d, counters);
+		return;
+	}
+
+	HeaderProbe probe;
+	bool sniff = sniffTypes && (d.type == ofxAssets::TYPE_UNKNOWN || isAmbiguousExtension(d.extension));
+	HeaderProbe * probePtr = (probeHeaders || sniff) ? &probe : nullptr;
+
+	if(contentAddressed && d.hasChecksum() && checkFromContentStore(d, counters)){
+		if(probePtr && d.status.localFileExists) applyHeaderProbe(d, probe);
+		return;
+	}
+
 	ofFile f;
 	f.open( d.relativePath );
 
+	//read the file once, hash it from memory and keep the bytes for the app to load
+	bool retainBytes = false;
+	ofBuffer bytes;
+
 	if(f.exists()){
 
 		d.status.localFileExists = true;
 
+		retainBytes = shouldRetainBytes(d, f.getSize());
+		if(retainBytes){
+			bytes = ofBufferFromFile(d.relativePath, true);
+			if(counters) counters->numBytes += bytes.size();
+			if(probePtr) probe.update(bytes.getData(), bytes.size());
+		}
+
 		if (d.hasChecksum()){
 			d.status.checksumSupplied = true;
 			d.status.localFileChecksumChecked = true;
 
-			if(d.checksumType == ofxChecksum::Type::SHA1){
-				d.status.checksumMatch = ofxChecksum::sha1(d.relativePath, d.checksum, false/*verbose*/);
-			}else{ //for now only two types, so it must be xxHash
-				auto sum = ofxChecksum::xxHash(d.relativePath);
-				d.status.checksumMatch = sum == d.checksum;
-			}
+			d.status.checksumMatch = verifyChecksum(d, retainBytes ? &bytes : nullptr, counters, probePtr);
 
 			if (d.status.checksumMatch){
 				ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' EXISTS and Checksum OK 😄");
@@ -250,6 +445,10 @@ void AssetHolder::checkLocalAssetStatus(ofxAssets::Descriptor & d){
 				}else{
 					ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' CORRUPT! (Checksum mismatch) 💩 expected \"" + d.checksum + "\"");
 				}
+				if(d.status.corruptChunks.size()){
+					ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' " + ofToString(d.status.corruptChunks.size()) +
+													" of " + ofToString(d.chunks.getNumChunks()) + " chunks are corrupt");
+				}
 			}
 		}else{ //no sha1 supplied!
 			ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' (Checksum not supplied) 🌚");
@@ -259,32 +458,231 @@ void AssetHolder::checkLocalAssetStatus(ofxAssets::Descriptor & d){
 				ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' file is empty!! 😨");
 			}
 		}
+		if(probePtr) applyHeaderProbe(d, probe);
 	}else{
 		d.status.localFileExists = false;
 		ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' Does NOT EXIST! 😞");
 	}
+	if(counters){
+		counters->numFiles++; //bytes were counted as we read them
+	}
 	f.close();
 	d.status.checked = true;
 
+	if(contentAddressed && d.status.checksumMatch){
+		adoptIntoContentStore(d);
+	}
+
+	if(retainBytes && isReadyToUse(d)){
+		verifiedBytes.store(d.relativePath, std::move(bytes));
+	}
 }
 
 
 
+bool AssetHolder::verifyChecksum(ofxAssets::Descriptor & d, const ofBuffer * bytes, ofxAssets::CheckCounters * counters,
+								 HeaderProbe * probe){
+
+	if(d.chunks.isValid()){ //one pass gives us the whole file checksum and the state of each chunk
+		ChunkVerifier verifier(d.checksumType, d.chunks);
+		if(bytes){
+			verifier.update(bytes->getData(), bytes->size());
+		}else{
+			readFileInBlocks(d.relativePath, [&](const char * data, size_t len){
+				verifier.update(data, len);
+				if(probe && !probe->isDone()) probe->update(data, len);
+			}, counters);
+		}
+		verifier.finish();
+		bool match = Hasher::checksumsMatch(verifier.getHexDigest(), d.checksum, d.checksumType);
+		if(!match){
+			d.status.corruptChunks = verifier.getCorruptChunks();
+		}
+		return match;
+	}
+
+	if(bytes){
+		string sum = Hasher::hashBuffer(bytes->getData(), bytes->size(), d.checksumType);
+		return Hasher::checksumsMatch(sum, d.checksum, d.checksumType);
+	}
+
+	//streamed in blocks, so progress moves along with big files too
+	Hasher hasher(d.checksumType);
+	if(!readFileInBlocks(d.relativePath, [&](const char * data, size_t len){
+		hasher.update(data, len);
+		if(probe && !probe->isDone()) probe->update(data, len);
+	}, counters)){
+		return false;
+	}
+	return hasher.matches(d.checksum);
+}
+
+
+bool AssetHolder::readFileInBlocks(const string & relativePath, std::function<void(const char *, size_t)> onBlock,
+								   ofxAssets::CheckCounters * counters){
+
+	std::ifstream file(ofToDataPath(relativePath, true), std::ios::in | std::ios::binary);
+	if(!file.is_open()) return false;
+
+	vector<char> block(1024 * 1024);
+	while(file){
+		file.read(block.data(), block.size());
+		std::streamsize n = file.gcount();
+		if(n > 0){
+			onBlock(block.data(), (size_t)n);
+			if(counters) counters->numBytes += n;
+		}
+	}
+	return file.eof();
+}
+
+
+void AssetHolder::applyHeaderProbe(ofxAssets::Descriptor & d, HeaderProbe & probe){
+
+	if(!probe.hasStarted() && !d.isPacked()){ //nothing was read to hash it, read just the headers
+		HeaderProbe::probeFile(d.relativePath, probe);
+	}
+	probe.finish();
+
+	if(sniffTypes && (d.type == ofxAssets::TYPE_UNKNOWN || isAmbiguousExtension(d.extension))){
+		ofxAssets::Type sniffed = probe.getType();
+		if(sniffed != ofxAssets::TYPE_UNKNOWN && sniffed != d.type){
+			ofxThreadSafeLog::one()->append(assetLogFile, "'" + d.relativePath + "' type sniffed from its contents: " +
+											HeaderProbe::toString(probe.getFormat()));
+			d.type = sniffed;
+		}
+	}
+	if(!probeHeaders) return;
+
+	HeaderProbe::Format expected = HeaderProbe::formatForExtension(d.extension);
+	if(expected != HeaderProbe::UNKNOWN_FORMAT && probe.getFormat() != expected){
+		d.status.headerMismatch = true;
+		ofxThreadSafeLog::one()->append(assetLogFile, "'" + d.relativePath + "' is not a " + d.extension + " file! Looks like " +
+										HeaderProbe::toString(probe.getFormat()) + " 🤔");
+	}
+	if(probe.getFormat() == HeaderProbe::UNKNOWN_FORMAT) return;
+
+	bool specsSupplied = d.specs.width > 0 || d.specs.height > 0;
+	if(probe.getWidth() > 0 && probe.getHeight() > 0 && (overwriteProbedSpecs || !specsSupplied)){
+		d.specs.width = probe.getWidth();
+		d.specs.height = probe.getHeight();
+		variantsDirty = true;
+	}
+	if(probe.getCodec().size() && (overwriteProbedSpecs || d.specs.codec.empty())){
+		d.specs.codec = probe.getCodec();
+	}
+}
+
+
+vector<string> AssetHolder::repairCorruptChunks(){
+
+	ensureResident();
+	vector<string> repaired;
+	AssetMap::iterator it = assets.begin();
+
+	while( it != assets.end() ){
+		ofxAssets::Descriptor & d = it->second;
+		if(d.location == REMOTE && d.status.checked && d.chunks.isValid() && d.status.corruptChunks.size()){
+			//if all of it is bad, leave it for downloadMissingAssets()
+			if(d.status.corruptChunks.size() < d.chunks.getNumChunks() && shouldDownload(d)){
+				if(repairChunks(d)){
+					repaired.push_back(d.relativePath);
+				}
+			}
+		}
+		++it;
+	}
+	return repaired;
+}
+
+
+bool AssetHolder::repairChunks(ofxAssets::Descriptor & d){
+
+	string finalPath = ofToDataPath(d.relativePath, true);
+	string path = finalPath;
+	vector<size_t> badChunks = d.status.corruptChunks;
+	ofLogNotice("AssetHolder") << "Repairing " << badChunks.size() << " corrupt chunks of \"" << d.relativePath << "\"";
+
+	//hard linked (ie to a content store blob): patch a copy of our own, or we'd change the others too
+	std::error_code lec;
+	bool linked = std::filesystem::hard_link_count(finalPath, lec) > 1 && !lec;
+	if(linked){
+		path = finalPath + ".repairing";
+		std::filesystem::copy_file(finalPath, path, std::filesystem::copy_options::overwrite_existing, lec);
+		if(lec){
+			ofLogError("AssetHolder") << "Can't copy \"" << finalPath << "\" for repair: " << lec.message();
+			return false;
+		}
+	}
+
+	try{
+		std::filesystem::resize_file(path, d.chunks.fileSize);
+	}catch(std::exception & e){
+		ofLogError("AssetHolder") << "Can't resize \"" << path << "\" for repair: " << e.what();
+		if(linked) std::filesystem::remove(path, lec);
+		return false;
+	}
+
+	std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+	if(!file.is_open()){
+		ofLogError("AssetHolder") << "Can't open \"" << path << "\" for repair!";
+		if(linked) std::filesystem::remove(path, lec);
+		return false;
+	}
+
+	int numRepaired = 0;
+	for(size_t i : badChunks){
+		string data, error;
+		uint64_t offset = d.chunks.getChunkOffset(i);
+		uint64_t len = d.chunks.getChunkLength(i);
+		if(!ofxAssets::HttpRange::fetch(d.url, offset, len, data, error)){
+			ofLogError("AssetHolder") << "Chunk " << i << " download KO! \"" << error << "\" \"" << d.url << "\"";
+			continue;
+		}
+		string sum = Hasher::hashBuffer(data.data(), data.size(), d.checksumType);
+		if(!Hasher::checksumsMatch(sum, d.chunks.chunkChecksums[i], d.checksumType)){
+			ofLogError("AssetHolder") << "Chunk " << i << " downloaded but checksum mismatch! [" << d.url << "]";
+			continue;
+		}
+		file.seekp(offset);
+		file.write(data.data(), data.size());
+		numRepaired++;
+	}
+	file.close();
+
+	if(linked){ //our patched copy takes our place; the blob and its other links are left as they were
+		std::filesystem::rename(path, finalPath, lec);
+		if(lec){
+			ofLogError("AssetHolder") << "Can't move repaired \"" << path << "\" into place: " << lec.message();
+			std::filesystem::remove(path, lec);
+			return false;
+		}
+	}
+
+	ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' repaired " + ofToString(numRepaired) + " of " +
+									ofToString(badChunks.size()) + " corrupt chunks 🩹");
+
+	checkLocalAssetStatus(d); //verify the whole thing again
+	return d.status.checksumMatch;
+}
+
+
 vector<string> AssetHolder::downloadMissingAssets(ofxDownloadCentral& downloader){
 
+	ensureResident();
 	if(!isDownloadingData){
 
 		vector<string> urls;
 		vector<string> checksums; //
 
-		unordered_map<string, ofxAssets::Descriptor>::iterator it = assets.begin();
+		AssetMap::iterator it = assets.begin();
 
 		while( it != assets.end() ){
 
 			ofxAssets::Descriptor & d = it->second;
 
 			if(d.location == REMOTE){
-				if(shouldDownload(d)){
+				if(shouldDownload(d) && !isDuplicateContent(d, checksums)){
 					urls.push_back(d.url);
 					checksums.push_back(d.checksum);
 				}
@@ -308,8 +706,59 @@ vector<string> AssetHolder::downloadMissingAssets(ofxDownloadCentral& downloader
 	return vector<string>();
 }
 
+
+vector<string> AssetHolder::downloadMissingAssets(AssetResumableDownloader& downloader){
+
+	ensureResident();
+	if(!isDownloadingData){
+
+		vector<string> urls;
+		vector<string> checksums;
+		vector<ofxChecksum::Type> checksumTypes;
+
+		AssetMap::iterator it = assets.begin();
+
+		while( it != assets.end() ){
+
+			ofxAssets::Descriptor & d = it->second;
+
+			if(d.location == REMOTE){
+				if(shouldDownload(d) && !isDuplicateContent(d, checksums)){
+					urls.push_back(d.url);
+					checksums.push_back(d.checksum);
+					checksumTypes.push_back(d.checksumType);
+				}
+			}
+			++it;
+		}
+
+		if(urls.size()){
+			downloader.downloadResources(urls, checksums, checksumTypes, this, &AssetHolder::downloadsFinished, directoryForAssets);
+			isDownloadingData = true;
+		}
+		return urls;
+	}else{
+		ofLogError("AssetHolder") << "Cant download now! Already downloading data...";
+	}
+	return vector<string>();
+}
+
+vector<ofxAssets::Descriptor> AssetHolder::getMissingAssets(){
+
+	ensureResident();
+	vector<ofxAssets::Descriptor> missing;
+	for(auto & it : assetAddOrder){
+		ofxAssets::Descriptor & d = assets[it.second];
+		if(d.location == REMOTE && shouldDownload(d)){
+			missing.push_back(d);
+		}
+	}
+	return missing;
+}
+
 vector<ofxAssets::Descriptor> AssetHolder::getAllAssetsInDB(){
 
+	ensureResident();
 	vector<ofxAssets::Descriptor> allAssets;
 	for(auto & it : assetAddOrder){
 		string assetPath = it.second;
@@ -318,3 +767,26 @@ vector<ofxAssets::Descriptor> AssetHolder::getAllAssetsInDB(){
 
 	return allAssets;
 }
+
+
+void AssetHolder::setRetainVerifiedBytes(bool retain, size_t memoryBudget){
+	retainVerifiedBytes = retain;
+	verifiedBytes.setMemoryBudget(retain ? memoryBudget : 0);
+}
+
+
+std::shared_ptr<const ofBuffer> AssetHolder::getVerifiedBytes(const string & relativePath){
+	return verifiedBytes.get(relativePath);
+}
+
+
+void AssetHolder::releaseVerifiedBytes(const string & relativePath){
+	verifiedBytes.release(relativePath);
+}
+
+
+bool AssetHolder::shouldRetainBytes(const ofxAssets::Descriptor &d, uint64_t fileSize){
+	if(!retainVerifiedBytes) return false;
+	if(d.type != ofxAssets::IMAGE && d.type != ofxAssets::JSON) return false;
+	return verifiedBytes.canHold(fileSize);
+}
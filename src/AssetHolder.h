@@ -21,8 +21,15 @@ using std::tr1::unordered_map;
 #include "AssetHolderStructs.h"
 #include "TagManager.h"
 #include "ofxChecksum.h"
+#include "AssetBytePool.h"
+#include "AssetPolicy.h"
+#include "AssetPack.h"
+#include "AssetHeaderProbe.h"
+#include "AssetTableArena.h"
 
 
+class AssetResumableDownloader;
+
 #define ASSET_HOLDER_SETUP_CHECK  if(!isSetup){ofLogError("Cant do! AssetHolder not setup!"); return "error!";}
 
 //make your object subclass AssetHolder, to handle gathering of remote assets.
@@ -33,6 +40,11 @@ class AssetHolder{
 public:
 
 	AssetHolder();
+	~AssetHolder();
+
+	//a copy is always resident (even if the original is paged out), gets its own shard if it's paged
+	//out, and keeps its tables on the heap (no arena). Not assignable, it never was (see assetLogFile).
+	AssetHolder(const AssetHolder & other);
 
 	//tell me when to download things that exists locally and when not to
 	void setup(const string& directoryForAssets,
@@ -42,6 +54,39 @@ public:
 	//for all assets in the app
 	static void setMinimumFileSize(int numBytes){minimumFileSize = numBytes;}
 
+	//Arena allocation: AssetHolders created while this is enabled keep their asset tables (the nodes and
+	//buckets of the descriptor map and of the add order) in a monotonic arena of their own, grown in blocks
+	//starting at initialBytes, and freed in one go when the holder is destroyed or paged out. For apps that
+	//create and destroy lots of holders. The strings inside each Descriptor and the tags still use the heap.
+	//Only available if the addon is built with OFX_ASSETS_ARENA defined (needs <memory_resource>, C++17).
+	static void setArenaAllocation(bool enabled, size_t initialBytes = 64 * 1024);
+	static bool isArenaAvailable();
+	bool usesArena() const;
+
+	//Verify-and-hand-off: when enabled, IMAGE and JSON assets are read into memory once while
+	//checking them, and kept around (up to memoryBudget bytes, shared by all AssetHolders) so
+	//that you can load them without reading them from disk again. Release them once loaded!
+	static void setRetainVerifiedBytes(bool retain, size_t memoryBudget = 64 * 1024 * 1024);
+	static std::shared_ptr<const ofBuffer> getVerifiedBytes(const string & relativePath); //nullptr if not retained
+	static void releaseVerifiedBytes(const string & relativePath);
+
+	//while checking, parse the headers of images, movies and audio (from the bytes read to hash them,
+	//or just the few header bytes if there's no checksum) to fill in Specs width / height / codec, and
+	//set status.headerMismatch on files whose contents contradict their extension. Specs you supplied
+	//are left alone unless overwriteSpecs.
+	static void setProbeHeaders(bool probe, bool overwriteSpecs = false){probeHeaders = probe; overwriteProbedSpecs = overwriteSpecs;}
+
+	//file extension -> Type, used when you add an asset without a type; case insensitive. Add your own
+	//extensions before adding assets (not thread safe). Ambiguous ones (ie mp4: video or audio?) get
+	//their default type until sniffed.
+	static void registerExtension(const string & extension, ofxAssets::Type type, bool ambiguous = false);
+	static ofxAssets::Type typeFromExtension(const string& extension); //TYPE_UNKNOWN if not registered
+	static bool isAmbiguousExtension(const string& extension);
+
+	//while checking, work out the type of assets with an unknown or ambiguous extension from their
+	//first bytes (see ofxAssets::HeaderProbe), when the contents are clear about it
+	static void setSniffTypes(bool sniff){sniffTypes = sniff;}
+
 	//use these to add assets easily, fill in most internal structure by just providing a few things
 	//return a constructed "relativePath" which will be the acces key
 	//when you add an asset, ofxAsset will try its best to tag it according to file extension
@@ -60,10 +105,37 @@ public:
 						 ofxAssets::Type type = ofxAssets::TYPE_UNKNOWN
 						 ); //path relative to data!
 
+	//copy a file (absolute, or relative to data; ie from a USB or NAS staging folder) into directoryForAssets,
+	//hashing it as it is copied, and add it as a local asset that is already checked; no need to run the
+	//AssetChecker on it. If expectedChecksum is supplied and doesn't match, nothing is added and "" is returned.
+	string importLocalAsset(const string& sourcePath,
+							const ofxChecksum::Type checksumType = ofxChecksum::Type::XX_HASH,
+							const string& expectedChecksum = "",
+							const vector<string>& tags = vector<string>(),
+							ofxAssets::Specs spec = ofxAssets::Specs(),
+							ofxAssets::Type type = ofxAssets::TYPE_UNKNOWN
+							);
+
+	//add an entry of an AssetPack (see AssetPack.h) as a local asset. Its relativePath is "packFile#entryName",
+	//which you can't open as a file; get its bytes with getPackedAsset(). Packs are checked in one read.
+	string addPackedAsset(const string& packFile, //relative to data
+						  const string& entryName,
+						  const vector<string>& tags = vector<string>(),
+						  ofxAssets::Specs spec = ofxAssets::Specs(),
+						  ofxAssets::Type type = ofxAssets::TYPE_UNKNOWN
+						  );
+
+	AssetPack::Slice getPackedAsset(const string & relativePath); //zero copy; invalid if not a packed asset
+
 	//totally custom - up to you to fill up the required structures - u should know what you are doing if you use this
 	void addAsset(const string& absoluteURL, const ofxAssets::Descriptor&);
 
 	bool areAllAssetsOK(); //should we drop this object? if assets are wrong, yes!
+	bool isAssetReadyToUse(const string & relativePath); //according to the UsagePolicy
+	void markAssetAsMissing(const string & relativePath); //ie its file was deleted behind our back
+	void markAssetAsCorrupt(const string & relativePath, const vector<size_t> & corruptChunks = vector<size_t>()); //ie found by AssetScrubber
+
+	const string & getDirectoryForAssets(){return directoryForAssets;}
 	vector<ofxAssets::Descriptor> getBrokenAssets();
 
 	// Access ...		//
@@ -75,6 +147,15 @@ public:
 	ofxAssets::Descriptor& getAssetDescForURL(const string& url);
 	vector<ofxAssets::Descriptor> getAssetDescriptorsForType(ofxAssets::Type);
 
+		// ... just where they are, for bookkeeping (ie AssetStoreManager). Doesn't page the holder in
+		// (reads the shard instead) and doesn't let you change anything, so no index gets rebuilt.
+	struct AssetPath{
+		string relativePath;
+		bool remote;
+		string packFile; //the file that holds it, if it's a packed asset (relativePath is not a file then)
+	};
+	vector<AssetPath> getAssetPaths() const; //in add order
+
 		// ... by Index
 	int getNumAssets();
 	ofxAssets::Descriptor& getAssetDescAtIndex(int i);	//in add order, 0 will be the first asset you added
@@ -87,13 +168,34 @@ public:
 	void addTagsforAsset(const string & relPath, vector<string> tags);
 	vector<ofxAssets::Descriptor> getAssetDescsWithTag(const string & tag);
 
+	// Variants //
+	//Assets with the same UserInfo::ID (or, if that's empty, the same file name once the UserInfo::size
+	//suffix is taken out; ie "1234_o.jpg" and "1234_b.jpg") are size variants of one logical asset, "1234".
+	//The index is (re)built the first time you ask after adding assets or touching their Specs / UserInfo.
+	string getVariantGroup(const string & relativePath); //the logical asset this one is a variant of
+	vector<string> getVariants(const string & group); //relativePaths, smallest first (by Specs::width * height)
+
+	//smallest variant that is ready to use and at least targetW x targetH (0 for "any"); if none is big
+	//enough, the biggest ready one. Variants without Specs size are only picked if no sized one is ready.
+	//group can also be the relativePath of any of the variants. "" if none is ready.
+	string bestVariantFor(const string & group, int targetW, int targetH);
+
 	// Stats //
 	ofxAssets::Stats getAssetStats();
 	static string toString(ofxAssets::Stats &s);
 
 	// Actions //
-	void updateLocalAssetsStatus(); //call this to check local filesystem and decide what is missing / needed
+	void updateLocalAssetsStatus(ofxAssets::CheckCounters * counters = nullptr); //call this to check local filesystem and decide what is missing / needed
+	//stat pass: adds the num of files and bytes updateLocalAssetsStatus() will go through to the counter totals
+	void addToCheckTotals(ofxAssets::CheckCounters * counters);
 	vector<string> downloadMissingAssets(ofxDownloadCentral& downloader); //return urls being downloaded
+	//same, but interrupted downloads (ie app restart) are resumed where they were left
+	vector<string> downloadMissingAssets(AssetResumableDownloader& downloader);
+
+	//for assets with a ChunkManifest, fetch only the corrupt chunks (HTTP Range) and patch the local
+	//file in place. Blocking! call from a thread (see AssetChecker::setRepairCorruptChunks()) after
+	//updateLocalAssetsStatus() and before downloadMissingAssets(). Returns repaired relative paths.
+	vector<string> repairCorruptChunks();
 
 	//assets that need to be downloaded
 	vector<ofxAssets::Descriptor> getMissingAssets();
@@ -102,18 +204,60 @@ public:
 	//its up to you to fill in data structures? TODO!
 	//unordered_map<string, AssetDescriptor>& getAssetsMap(){return assets;}
 
+	//Content addressed storage: verified files are kept once in storeDirectory (relative to data), named
+	//after their checksum, and each asset's relativePath is a hard link to that blob. Assets with the
+	//same content under different urls are downloaded once, and each blob is only hashed once per check
+	//pass, no matter how many holders share it. Only assets with a checksum are stored this way.
+	static void setContentAddressedStorage(bool enabled, const string & storeDirectory = "assetStore");
+	static bool isContentAddressed(){return contentAddressed;}
+	static string getContentStoreDirectory(){return contentStoreDirectory;}
+	//AssetChecker and AssetAsyncCheck start a new pass with each check; call this yourself before
+	//calling updateLocalAssetsStatus() directly if you want blobs hashed again
+	static void startVerificationPass(){verificationPass++;}
+
+	// Residency //
+	//Page this holder's descriptors, tags and user info out to a shard file (in the shard directory,
+	//relative to data) to save memory; only the packed status and the stats stay resident, so
+	//areAllAssetsOK(), getAssetStats() and getNumAssets() don't bring it back. Anything else that
+	//needs the descriptors faults them back in, transparently. Dont page out while checking/downloading.
+	//pageOut() checks the shard reads back before dropping anything. If it's corrupt by the time we page
+	//back in, pageIn() fails loudly and the holder comes back empty (the shard is kept as "*.corrupt").
+	//Shards left behind by earlier runs are removed the first time a holder pages out.
+	bool pageOut();
+	bool pageIn();
+	bool isPagedOut(){return pagedOut;}
+	static void setShardDirectory(const string & dir){shardDirectory = dir;}
+	static string getShardDirectory(){return shardDirectory;}
+
 	// CALLBACK //
 	void downloadsFinished(ofxBatchDownloaderReport & report);
 
 protected:
 
-	ofxAssets::Type typeFromExtension(const string& extension);
-	void checkLocalAssetStatus(ofxAssets::Descriptor & d);
+	void checkLocalAssetStatus(ofxAssets::Descriptor & d, ofxAssets::CheckCounters * counters = nullptr);
+	bool verifyChecksum(ofxAssets::Descriptor & d, const ofBuffer * bytes, ofxAssets::CheckCounters * counters,
+						ofxAssets::HeaderProbe * probe = nullptr); //bytes can be nullptr; probe is fed as we read
+	void applyHeaderProbe(ofxAssets::Descriptor & d, ofxAssets::HeaderProbe & probe); //probes the file if nobody fed it
+	bool repairChunks(ofxAssets::Descriptor & d);
+	void checkPackedAssetStatus(ofxAssets::Descriptor & d, ofxAssets::CheckCounters * counters);
+	void invalidatePacks(); //of our packed assets
+	static bool readFileInBlocks(const string & relativePath, std::function<void(const char *, size_t)> onBlock,
+								 ofxAssets::CheckCounters * counters = nullptr); //counts bytes as they are read
 
 	//the actual assets
-	map<int, string> assetAddOrder;
-	std::unordered_map<string, ofxAssets::Descriptor> assets; 	//index by relativePath
-															//2 assets cant have the same path!
+	#if defined(OFX_ASSETS_ARENA)
+	typedef std::pmr::map<int, string> AssetOrderMap;
+	typedef std::pmr::unordered_map<string, ofxAssets::Descriptor> AssetMap;
+	std::unique_ptr<ofxAssets::TableArena> arena; //declared before the tables, so it outlives them
+	std::pmr::memory_resource * memoryResource();
+	#else
+	typedef map<int, string> AssetOrderMap;
+	typedef std::unordered_map<string, ofxAssets::Descriptor> AssetMap;
+	#endif
+	AssetOrderMap assetAddOrder;
+	AssetMap assets; 	//index by relativePath
+						//2 assets cant have the same path!
+	void resetAssetTables(); //drops all assets and gives their memory back
 
 	string directoryForAssets;
 	bool isDownloadingData;
@@ -122,8 +266,17 @@ protected:
 	ofxAssets::UsagePolicy assetOkPolicy;
 	ofxAssets::DownloadPolicy downloadPolicy;
 
+	//policies are compiled at setup() into a lookup over the packed LocalAssetStatus bits, bulk queries
+	//run over packedStatus (one byte per asset, in add order) instead of over the assets map
+	ofxAssets::CompiledPolicy compiledPolicy;
+	vector<uint8_t> packedStatus;
+	bool packedStatusDirty = true;
+	size_t numUncheckedAssets = 0;
+	void updatePackedStatus();
+
 	bool shouldDownload(const ofxAssets::Descriptor &d);
 	bool isReadyToUse(const ofxAssets::Descriptor &d);
+	bool shouldRetainBytes(const ofxAssets::Descriptor &d, uint64_t fileSize);
 
 	enum TagCategory{
 		CATEGORY
@@ -131,6 +284,35 @@ protected:
 
 	TagManager<TagCategory> tags = TagManager<TagCategory>(1); //only one category - forcing with our custom enum
 
+	//content addressed storage
+	static string blobPathFor(const ofxAssets::Descriptor & d);
+	bool checkFromContentStore(ofxAssets::Descriptor & d, ofxAssets::CheckCounters * counters); //true if it was
+	void adoptIntoContentStore(const ofxAssets::Descriptor & d);
+	void linkDuplicatesFromContentStore(); //after downloading, fills in same-content assets we skipped
+	bool isDuplicateContent(const ofxAssets::Descriptor & d, const vector<string> & checksumsToDownload);
+
+	//import
+	static bool copyAndHash(const string & from, const string & to, ofxChecksum::Type checksumType,
+							string & checksum, uint64_t & numBytes, string & error); //abs paths
+
+	//variants
+	std::unordered_map<string, vector<string>> variants; //group -> relativePaths, smallest first
+	std::unordered_map<string, string> variantGroups; //relativePath -> group
+	bool variantsDirty = true;
+	void buildVariantIndex();
+	static string variantGroupFor(const ofxAssets::Descriptor & d);
+
+	//residency
+	std::atomic<bool> pagedOut{false}; //read without residencyMutex by ensureResident()
+	mutable std::mutex residencyMutex;
+	string shardPath;
+	size_t numPagedOutAssets = 0;
+	ofxAssets::Stats pagedOutStats;
+	void ensureResident(); //call before touching assets, assetAddOrder or tags
+	bool pageInLocked();
+	bool readShardInto(const string & path, size_t numAssets); //fills our tables and tags
+	static string newShardPath();
+
 private:
 
 	//meh
@@ -138,6 +320,26 @@ private:
 	static ofxAssets::UserInfo emptyUserInfo;
 	static int minimumFileSize;
 	static ofMutex assetMutex;
+	static bool retainVerifiedBytes;
+	static bool probeHeaders;
+	static bool overwriteProbedSpecs;
+	static bool sniffTypes;
+	static bool useArena;
+	static size_t arenaInitialBytes;
+	static ofxAssets::BytePool verifiedBytes;
+	static string shardDirectory;
+	static bool contentAddressed;
+	static string contentStoreDirectory;
+	struct BlobVerdict{
+		uint64_t pass; //only trusted during the verification pass it was made in
+		bool hashing; //someone is on it, wait for them
+		bool ok;
+	};
+	static std::unordered_map<string, BlobVerdict> verifiedBlobs; //blob path >> hashed by us (or being hashed)
+	static std::atomic<uint64_t> verificationPass;
+	static std::mutex blobMutex;
+	static std::condition_variable blobHashed;
+	static std::atomic<int> shardCounter;
 
 //	ofLogLevel oldSimpleHttpLevel;
 //	ofLogLevel oldBatchDownloaderLevel;
@@ -0,0 +1,186 @@
+//
+//  AssetHolderImport.cpp
+//  ofxAssets
+//
+//	importing local files: copy into the asset directory and hash in the same pass, so the
+//	imported asset is already checked.
+//
+
+#include "AssetHolder.h"
+#include "AssetHasher.h"
+#include "ofxThreadSafeLog.h"
+
+
+string AssetHolder::importLocalAsset(const string& sourcePath,
+									 const ofxChecksum::Type checksumType,
+									 const string& expectedChecksum,
+									 const vector<string>& tags,
+									 ofxAssets::Specs spec,
+									 ofxAssets::Type type){
+
+	ASSET_HOLDER_SETUP_CHECK;
+	ensureResident();
+
+	ofxAssets::Descriptor ad;
+	ad.fileName = ofFilePath::getFileName(sourcePath);
+	ad.relativePath = ofToDataPath(directoryForAssets + ad.fileName, false);
+
+	if(assets.find(ad.relativePath) != assets.end()){
+		ofLogError("AssetHolder") << " Can't import this asset, already have it! " << ad.relativePath;
+		return "";
+	}
+
+	string from = ofToDataPath(sourcePath, true);
+	string to = ofToDataPath(ad.relativePath, true);
+	string checksum, error;
+	uint64_t numBytes = 0;
+	bool inPlace = false;
+	std::error_code err;
+	if(std::filesystem::exists(to, err) && std::filesystem::equivalent(from, to, err)){
+		inPlace = true; //already in the asset directory, just hash it
+		ofxAssets::Hasher hasher(checksumType);
+		bool ok = readFileInBlocks(ad.relativePath, [&](const char * data, size_t len){
+			hasher.update(data, len);
+		});
+		checksum = hasher.getHexDigest();
+		numBytes = hasher.getNumBytesHashed();
+		if(!ok) error = "can't read \"" + from + "\"";
+	}else{
+		ofDirectory::createDirectory(directoryForAssets, true, true);
+		copyAndHash(from, to, checksumType, checksum, numBytes, error);
+	}
+
+	if(error.size()){
+		ofLogError("AssetHolder") << "Can't import \"" << sourcePath << "\": " << error;
+		return "";
+	}
+
+	if(expectedChecksum.size() && !ofxAssets::Hasher::checksumsMatch(checksum, expectedChecksum, checksumType)){
+		ofLogError("AssetHolder") << "Can't import \"" << sourcePath << "\": checksum mismatch, expected \""
+								  << expectedChecksum << "\" got \"" << checksum << "\"";
+		if(!inPlace) ofFile::removeFile(to, false);
+		return "";
+	}
+
+	ad.location = ofxAssets::LOCAL;
+	ad.extension = ofFilePath::getFileExt(sourcePath);
+	ad.specs = spec;
+	ad.type = (type == ofxAssets::TYPE_UNKNOWN) ? typeFromExtension(ad.extension) : type;
+	ad.checksum = checksum;
+	ad.checksumType = checksumType;
+
+	//same outcome as checkLocalAssetStatus() would give us
+	ad.status.localFileExists = true;
+	ad.status.checksumSupplied = true;
+	ad.status.localFileChecksumChecked = true;
+	ad.status.checksumMatch = true;
+	ad.status.fileTooSmall = numBytes < minimumFileSize;
+	ad.status.checked = true;
+	releaseVerifiedBytes(ad.relativePath); //might be stale if we replaced the file
+
+	assetAddOrder[assetAddOrder.size()] = ad.relativePath;
+	assets[ad.relativePath] = ad;
+	packedStatusDirty = true;
+	variantsDirty = true;
+	for(auto & tag : tags){
+		string objectID = ad.relativePath; //assets inside an AssetHodler are indexed by they relative path
+		this->tags.addTagForObject(objectID, Tag<TagCategory>(tag, CATEGORY));
+	}
+	ofxThreadSafeLog::one()->append(assetLogFile, "'" + ad.relativePath + "' IMPORTED from '" + sourcePath + "' Checksum " + checksum + " 😄");
+
+	if(contentAddressed){
+		adoptIntoContentStore(ad);
+	}
+	return ad.relativePath;
+}
+
+
+bool AssetHolder::copyAndHash(const string & from, const string & to, ofxChecksum::Type checksumType,
+							  string & checksum, uint64_t & numBytes, string & error){
+
+	std::ifstream in(from, std::ios::in | std::ios::binary);
+	if(!in.is_open()){
+		error = "can't open \"" + from + "\"";
+		return false;
+	}
+	string tmpPath = to + ".importing"; //so a half copied file never looks like an asset
+	std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open()){
+		error = "can't write to \"" + tmpPath + "\"";
+		return false;
+	}
+
+	//one reader thread fills the next block while this one is hashed and written
+	const size_t blockSize = 1024 * 1024;
+	vector<char> blocks[2] = {vector<char>(blockSize), vector<char>(blockSize)};
+	size_t blockLen[2] = {0, 0};
+	bool blockFull[2] = {false, false};
+	bool quit = false;
+	std::mutex blockMutex;
+	std::condition_variable blockChanged;
+
+	std::thread reader([&](){
+		for(int i = 0; ; i = 1 - i){
+			{
+				std::unique_lock<std::mutex> lock(blockMutex);
+				blockChanged.wait(lock, [&]{ return !blockFull[i] || quit; });
+				if(quit) return;
+			}
+			in.read(blocks[i].data(), blockSize);
+			size_t n = (size_t)in.gcount();
+			{
+				std::unique_lock<std::mutex> lock(blockMutex);
+				blockLen[i] = n;
+				blockFull[i] = true;
+			}
+			blockChanged.notify_all();
+			if(n == 0) return; //end of file (or error), the empty block says so
+		}
+	});
+
+	ofxAssets::Hasher hasher(checksumType);
+	for(int i = 0; ; i = 1 - i){
+		size_t n;
+		{
+			std::unique_lock<std::mutex> lock(blockMutex);
+			blockChanged.wait(lock, [&]{ return blockFull[i]; });
+			n = blockLen[i];
+		}
+		if(n == 0) break;
+		hasher.update(blocks[i].data(), n);
+		out.write(blocks[i].data(), n);
+		{
+			std::unique_lock<std::mutex> lock(blockMutex);
+			blockFull[i] = false;
+			if(!out) quit = true;
+		}
+		blockChanged.notify_all();
+		if(!out){
+			error = "write error on \"" + tmpPath + "\"";
+			break;
+		}
+	}
+	reader.join();
+	if(in.bad() && error.empty()){
+		error = "read error on \"" + from + "\"";
+	}
+	out.close();
+	if(out.fail() && error.empty()){
+		error = "can't finish writing \"" + tmpPath + "\"";
+	}
+
+	if(error.empty()){
+		try{
+			std::filesystem::rename(tmpPath, to); //atomic, replaces the old file if any
+		}catch(std::exception & e){
+			error = string("can't move import into place: ") + e.what();
+		}
+	}
+	if(error.size()){
+		ofFile::removeFile(tmpPath, false);
+		return false;
+	}
+	checksum = hasher.getHexDigest();
+	numBytes = hasher.getNumBytesHashed();
+	return true;
+}
@@ -0,0 +1,120 @@
+//
+//  AssetHolderPack.cpp
+//  ofxAssets
+//
+//	assets that are entries of an AssetPack: checked with one sequential read of the whole pack,
+//	read as slices of its mapping.
+//
+
+#include "AssetHolder.h"
+#include "AssetHasher.h"
+#include "ofxThreadSafeLog.h"
+#include <unordered_set>
+
+
+string AssetHolder::addPackedAsset(const string& packFile,
+								   const string& entryName,
+								   const vector<string>& tags,
+								   ofxAssets::Specs spec,
+								   ofxAssets::Type type){
+
+	ASSET_HOLDER_SETUP_CHECK;
+	ensureResident();
+
+	ofxAssets::Descriptor ad;
+	ad.packFile = ofToDataPath(packFile, false);
+	ad.packEntry = entryName;
+	ad.relativePath = ad.packFile + "#" + entryName;
+
+	if(assets.find(ad.relativePath) == assets.end()){ //we dont have this one
+		ad.location = ofxAssets::LOCAL;
+		ad.fileName = ofFilePath::getFileName(entryName);
+		ad.extension = ofFilePath::getFileExt(entryName);
+		ad.type = (type == ofxAssets::TYPE_UNKNOWN) ? typeFromExtension(ad.extension) : type;
+		ad.specs = spec;
+		assetAddOrder[assetAddOrder.size()] = ad.relativePath;
+		assets[ad.relativePath] = ad;
+		packedStatusDirty = true;
+		variantsDirty = true;
+		for(auto & tag : tags){
+			string objectID = ad.relativePath; //assets inside an AssetHodler are indexed by they relative path
+			this->tags.addTagForObject(objectID, Tag<TagCategory>(tag, CATEGORY));
+		}
+	}else{
+		ofLogError("AssetHolder") << " Can't add this packed asset, already have it! " << ad.relativePath;
+	}
+	return ad.relativePath;
+}
+
+
+AssetPack::Slice AssetHolder::getPackedAsset(const string & relativePath){
+	ensureResident();
+	auto it = assets.find(relativePath);
+	if(it == assets.end() || !it->second.isPacked()){
+		return AssetPack::Slice();
+	}
+	auto pack = AssetPack::get(it->second.packFile);
+	if(!pack) return AssetPack::Slice();
+	return pack->getSlice(it->second.packEntry);
+}
+
+
+void AssetHolder::checkPackedAssetStatus(ofxAssets::Descriptor & d, ofxAssets::CheckCounters * counters){
+
+	auto pack = AssetPack::get(d.packFile);
+	const AssetPack::Entry * e = pack ? pack->getEntry(d.packEntry) : nullptr;
+
+	if(e){
+		//only the first asset of each pack pays for hashing it, per check pass
+		bool entryOK = pack->verifyEntry(d.packEntry, counters);
+		d.status.localFileExists = true;
+		d.status.checksumSupplied = true; //by the pack, if not by us
+		d.status.localFileChecksumChecked = true;
+		if(!d.hasChecksum()){ //take the pack's
+			d.checksum = e->checksum;
+			d.checksumType = pack->getChecksumType();
+		}
+		if(d.checksumType == pack->getChecksumType()){
+			d.status.checksumMatch = entryOK &&
+									 ofxAssets::Hasher::checksumsMatch(e->checksum, d.checksum, d.checksumType);
+		}else{ //hash it again our way, it's mapped already
+			AssetPack::Slice s = pack->getSlice(d.packEntry);
+			ofxAssets::Hasher hasher(d.checksumType);
+			hasher.update(s.data, s.size);
+			d.status.checksumMatch = hasher.matches(d.checksum);
+		}
+		if(d.status.checksumMatch){
+			ofxThreadSafeLog::one()->append(assetLogFile, "'" + d.relativePath + "' EXISTS and Checksum OK 😄");
+		}else{
+			d.status.fileTooSmall = e->size < minimumFileSize;
+			ofxThreadSafeLog::one()->append(assetLogFile, "'" + d.relativePath + "' CORRUPT! (Checksum mismatch) 💩 expected \"" + d.checksum + "\"");
+		}
+	}else{
+		d.status.localFileExists = false;
+		ofxThreadSafeLog::one()->append(assetLogFile, "'" + d.relativePath + "' Does NOT EXIST! 😞" +
+										(pack ? "" : " (can't open pack)"));
+	}
+	bool sniff = sniffTypes && (d.type == ofxAssets::TYPE_UNKNOWN || isAmbiguousExtension(d.extension));
+	if(e && (probeHeaders || sniff)){ //the headers are mapped already
+		AssetPack::Slice s = pack->getSlice(d.packEntry);
+		ofxAssets::HeaderProbe probe;
+		probe.update(s.data, s.size);
+		applyHeaderProbe(d, probe);
+	}
+	if(counters){
+		counters->numFiles++; //bytes were counted as the pack was read
+	}
+	d.status.checked = true;
+}
+
+
+void AssetHolder::invalidatePacks(){ //so a check pass hashes them again, they may have changed since
+	std::unordered_set<string> packFiles;
+	for(auto & it : assets){
+		if(it.second.isPacked()) packFiles.insert(it.second.packFile);
+	}
+	for(auto & packFile : packFiles){
+		auto pack = AssetPack::get(packFile);
+		if(pack) pack->invalidate();
+	}
+}
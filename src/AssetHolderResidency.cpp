@@ -0,0 +1,322 @@
+//
+//  AssetHolderResidency.cpp
+//  ofxAssets
+//
+//	paging an AssetHolder's descriptors out to a shard file and back in.
+//
+
+#include "AssetHolder.h"
+
+string AssetHolder::shardDirectory = "assetShards";
+std::atomic<int> AssetHolder::shardCounter(0);
+
+static const char shardMagic[8] = {'O', 'F', 'X', 'A', 'S', 'H', 'D', '1'};
+
+//shard records are little more than length prefixed strings and fixed size ints, in add order
+namespace{
+
+	struct ShardWriter{
+		std::ofstream & out;
+		void u64(uint64_t v){ out.write((const char*)&v, sizeof(v)); }
+		void str(const string & s){ u64(s.size()); out.write(s.data(), s.size()); }
+		void flag(bool b){ char c = b ? 1 : 0; out.write(&c, 1); }
+	};
+
+	struct ShardReader{
+		std::ifstream & in;
+		uint64_t u64(){ uint64_t v = 0; in.read((char*)&v, sizeof(v)); return v; }
+		string str(){
+			uint64_t len = u64();
+			if(!in || len > (1ull << 32)){ in.setstate(std::ios::failbit); return string(); }
+			string s(len, '\0');
+			in.read(&s[0], len);
+			return s;
+		}
+		bool flag(){ char c = 0; in.read(&c, 1); return c != 0; }
+	};
+
+	//one descriptor as pageOut() writes it; false if the shard ends / is broken
+	bool readShardRecord(ShardReader & r, ofxAssets::Descriptor & d, vector<string> & tagNames){
+
+		std::ifstream & in = r.in;
+		d.fileName = r.str(); d.extension = r.str(); d.relativePath = r.str(); d.url = r.str();
+		d.checksum = r.str(); d.checksumType = (ofxChecksum::Type)r.u64();
+		d.type = (ofxAssets::Type)r.u64(); d.location = (ofxAssets::Location)r.u64();
+
+		ofxAssets::UserInfo & u = d.userInfo;
+		u.title = r.str(); u.hasSubtitles = r.flag(); u.description = r.str(); u.size = r.str(); u.ID = r.str();
+		uint64_t numExtra = r.u64();
+		for(uint64_t j = 0; j < numExtra && in; j++){
+			string key = r.str();
+			u.extra[key] = r.str();
+		}
+
+		d.specs.codec = r.str(); d.specs.width = (int)r.u64(); d.specs.height = (int)r.u64();
+
+		ofxAssets::LocalAssetStatus & s = d.status;
+		s.localFileExists = r.flag(); s.checksumSupplied = r.flag(); s.localFileChecksumChecked = r.flag();
+		s.checksumMatch = r.flag(); s.fileTooSmall = r.flag(); s.checked = r.flag(); s.downloaded = r.flag(); s.downloadOK = r.flag();
+		uint64_t numCorrupt = r.u64();
+		for(uint64_t j = 0; j < numCorrupt && in; j++) s.corruptChunks.push_back(r.u64());
+		s.headerMismatch = r.flag();
+
+		d.chunks.fileSize = r.u64(); d.chunks.chunkSize = r.u64();
+		uint64_t numChunks = r.u64();
+		for(uint64_t j = 0; j < numChunks && in; j++) d.chunks.chunkChecksums.push_back(r.str());
+
+		d.packFile = r.str(); d.packEntry = r.str();
+
+		uint64_t numTags = r.u64();
+		for(uint64_t j = 0; j < numTags && in; j++) tagNames.push_back(r.str());
+		return (bool)in;
+	}
+
+	//calls onRecord for each record of the shard at path; false unless all of them (and exactly
+	//expectedRecords of them) could be read
+	bool readShard(const string & path, uint64_t expectedRecords,
+				   std::function<void(ofxAssets::Descriptor &, vector<string> &)> onRecord){
+
+		std::ifstream in(path, std::ios::in | std::ios::binary);
+		char magic[sizeof(shardMagic)] = {0};
+		in.read(magic, sizeof(magic));
+		if(!in || memcmp(magic, shardMagic, sizeof(magic)) != 0){
+			return false;
+		}
+		ShardReader r{in};
+		uint64_t n = r.u64();
+		if(!in || n != expectedRecords) return false;
+		for(uint64_t i = 0; i < n; i++){
+			ofxAssets::Descriptor d;
+			vector<string> tagNames;
+			if(!readShardRecord(r, d, tagNames)) return false;
+			onRecord(d, tagNames);
+		}
+		return true;
+	}
+
+	//shards of earlier runs (that crashed before their holders were destroyed) are older than us
+	const std::filesystem::file_time_type residencyStart = std::filesystem::file_time_type::clock::now();
+	bool staleShardsRemoved = false;
+	std::mutex staleShardsMutex;
+
+	void removeStaleShards(const string & dir){
+		std::unique_lock<std::mutex> lock(staleShardsMutex);
+		if(staleShardsRemoved) return;
+		staleShardsRemoved = true;
+		std::error_code ec;
+		for(std::filesystem::directory_iterator it(ofToDataPath(dir, true), ec), end; !ec && it != end; it.increment(ec)){
+			std::error_code fec;
+			const std::filesystem::path & p = it->path();
+			string ext = p.extension().string();
+			if(ext != ".shard" && ext != ".corrupt") continue;
+			auto modified = std::filesystem::last_write_time(p, fec);
+			if(!fec && modified < residencyStart && std::filesystem::remove(p, fec)){
+				ofLogNotice("AssetHolder") << "Removed stale shard \"" << p.string() << "\"";
+			}
+		}
+	}
+}
+
+
+AssetHolder::AssetHolder(const AssetHolder & other){
+
+	std::unique_lock<std::mutex> lock(other.residencyMutex);
+	directoryForAssets = other.directoryForAssets;
+	isDownloadingData = false; //the downloads report to the original
+	isSetup = other.isSetup;
+	assetOkPolicy = other.assetOkPolicy;
+	downloadPolicy = other.downloadPolicy;
+	compiledPolicy = other.compiledPolicy;
+	packedStatus = other.packedStatus;
+	packedStatusDirty = other.packedStatusDirty;
+	numUncheckedAssets = other.numUncheckedAssets;
+
+	if(other.pagedOut){ //read the original's shard, leaving it paged out
+		if(!readShardInto(other.shardPath, other.numPagedOutAssets)){
+			ofLogError("AssetHolder") << "Can't copy paged out AssetHolder, its shard \"" << other.shardPath << "\" is corrupt!";
+			resetAssetTables();
+			tags = TagManager<TagCategory>(1);
+		}
+		packedStatusDirty = true;
+	}else{
+		assetAddOrder = other.assetAddOrder;
+		assets = other.assets;
+		tags = other.tags;
+		variants = other.variants;
+		variantGroups = other.variantGroups;
+		variantsDirty = other.variantsDirty;
+	}
+}
+
+
+AssetHolder::~AssetHolder(){
+	if(pagedOut){
+		ofFile::removeFile(shardPath, false);
+	}
+}
+
+
+bool AssetHolder::pageOut(){
+
+	std::unique_lock<std::mutex> lock(residencyMutex);
+	if(pagedOut) return true;
+	if(isDownloadingData){
+		ofLogError("AssetHolder") << "Can't page out while downloading!";
+		return false;
+	}
+
+	updatePackedStatus();
+	if(numUncheckedAssets == 0){ //getAssetStats() complains otherwise
+		pagedOutStats = getAssetStats();
+	}else{
+		pagedOutStats = ofxAssets::Stats();
+		pagedOutStats.numAssets = assets.size();
+	}
+
+	if(shardPath.empty()){
+		shardPath = newShardPath();
+	}
+
+	std::ofstream out(shardPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open()){
+		ofLogError("AssetHolder") << "Can't write shard \"" << shardPath << "\"";
+		return false;
+	}
+
+	ShardWriter w{out};
+	out.write(shardMagic, sizeof(shardMagic));
+	w.u64(assetAddOrder.size());
+	for(auto & it : assetAddOrder){
+		const ofxAssets::Descriptor & d = assets[it.second];
+		w.str(d.fileName); w.str(d.extension); w.str(d.relativePath); w.str(d.url);
+		w.str(d.checksum); w.u64((uint64_t)d.checksumType);
+		w.u64(d.type); w.u64(d.location);
+
+		const ofxAssets::UserInfo & u = d.userInfo;
+		w.str(u.title); w.flag(u.hasSubtitles); w.str(u.description); w.str(u.size); w.str(u.ID);
+		w.u64(u.extra.size());
+		for(auto & e : u.extra){ w.str(e.first); w.str(e.second); }
+
+		w.str(d.specs.codec); w.u64(d.specs.width); w.u64(d.specs.height);
+
+		const ofxAssets::LocalAssetStatus & s = d.status;
+		w.flag(s.localFileExists); w.flag(s.checksumSupplied); w.flag(s.localFileChecksumChecked);
+		w.flag(s.checksumMatch); w.flag(s.fileTooSmall); w.flag(s.checked); w.flag(s.downloaded); w.flag(s.downloadOK);
+		w.u64(s.corruptChunks.size());
+		for(auto c : s.corruptChunks) w.u64(c);
+		w.flag(s.headerMismatch);
+
+		w.u64(d.chunks.fileSize); w.u64(d.chunks.chunkSize); w.u64(d.chunks.chunkChecksums.size());
+		for(auto & c : d.chunks.chunkChecksums) w.str(c);
+
+		w.str(d.packFile); w.str(d.packEntry);
+
+		vector<Tag<TagCategory>> assetTags = tags.getTagsForObject(d.relativePath);
+		w.u64(assetTags.size());
+		for(auto & t : assetTags) w.str(t.getName());
+	}
+	out.close();
+	if(!out){
+		ofLogError("AssetHolder") << "Can't write shard \"" << shardPath << "\"";
+		ofFile::removeFile(shardPath, false);
+		return false;
+	}
+
+	//only let go of the assets once we know we can get them back
+	if(!readShard(shardPath, assetAddOrder.size(), [](ofxAssets::Descriptor &, vector<string> &){})){
+		ofLogError("AssetHolder") << "Shard \"" << shardPath << "\" doesn't read back! staying resident";
+		ofFile::removeFile(shardPath, false);
+		return false;
+	}
+
+	numPagedOutAssets = assets.size();
+	resetAssetTables();
+	tags = TagManager<TagCategory>(1);
+	std::unordered_map<string, vector<string>>().swap(variants);
+	std::unordered_map<string, string>().swap(variantGroups);
+	variantsDirty = true;
+	pagedOut = true;
+	return true;
+}
+
+
+string AssetHolder::newShardPath(){
+	ofDirectory::createDirectory(shardDirectory, true, true);
+	removeStaleShards(shardDirectory);
+	return ofToDataPath(ofFilePath::addTrailingSlash(shardDirectory) + ofToString(ofGetUnixTime()) + "_" +
+						ofToString(shardCounter++) + ".shard", true);
+}
+
+
+bool AssetHolder::pageIn(){
+	std::unique_lock<std::mutex> lock(residencyMutex);
+	return pageInLocked();
+}
+
+
+void AssetHolder::ensureResident(){
+	if(pagedOut){
+		std::unique_lock<std::mutex> lock(residencyMutex);
+		if(pagedOut) pageInLocked();
+	}
+}
+
+
+bool AssetHolder::pageInLocked(){
+
+	if(!pagedOut) return true;
+
+	bool ok = readShardInto(shardPath, numPagedOutAssets);
+	packedStatusDirty = true;
+
+	if(ok){
+		ofFile::removeFile(shardPath, false);
+	}else{ //it was fine when we wrote it, someone messed with it. No half holders: drop it all, keep the shard to look at
+		ofLogFatalError("AssetHolder") << "Shard \"" << shardPath << "\" is corrupt! this holder lost its " << numPagedOutAssets
+			<< " assets; shard kept as \"" << shardPath << ".corrupt\"";
+		resetAssetTables();
+		tags = TagManager<TagCategory>(1);
+		std::error_code ec;
+		std::filesystem::rename(shardPath, shardPath + ".corrupt", ec);
+	}
+	pagedOut = false; //last, so ensureResident() never sees half filled tables
+	return ok;
+}
+
+
+bool AssetHolder::readShardInto(const string & path, size_t numAssets){
+	variantsDirty = true;
+	return readShard(path, numAssets, [this](ofxAssets::Descriptor & d, vector<string> & tagNames){
+		for(auto & t : tagNames){
+			tags.addTagForObject(d.relativePath, Tag<TagCategory>(t, CATEGORY));
+		}
+		assetAddOrder[assetAddOrder.size()] = d.relativePath;
+		assets[d.relativePath] = d;
+	});
+}
+
+
+vector<AssetHolder::AssetPath> AssetHolder::getAssetPaths() const{
+
+	std::unique_lock<std::mutex> lock(residencyMutex);
+	vector<AssetPath> paths;
+
+	if(!pagedOut){
+		paths.reserve(assetAddOrder.size());
+		for(auto & it : assetAddOrder){
+			auto a = assets.find(it.second);
+			if(a == assets.end()) continue;
+			paths.push_back(AssetPath{a->second.relativePath, a->second.location == ofxAssets::REMOTE, a->second.packFile});
+		}
+		return paths;
+	}
+
+	paths.reserve(numPagedOutAssets);
+	bool ok = readShard(shardPath, numPagedOutAssets, [&paths](ofxAssets::Descriptor & d, vector<string> &){
+		paths.push_back(AssetPath{d.relativePath, d.location == ofxAssets::REMOTE, d.packFile});
+	});
+	if(!ok){
+		ofLogError("AssetHolder") << "Can't read shard \"" << shardPath << "\" to list asset paths!";
+	}
+	return paths;
+}
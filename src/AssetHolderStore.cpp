@@ -0,0 +1,187 @@
+//
+//  AssetHolderStore.cpp
+//  ofxAssets
+//
+//	content addressed storage: files live in the store under their checksum, and each asset's
+//	relativePath is a hard link to its blob (or a copy where hard links are not possible).
+//
+
+#include "AssetHolder.h"
+#include "AssetHasher.h"
+#include "ofxThreadSafeLog.h"
+
+bool AssetHolder::contentAddressed = false;
+string AssetHolder::contentStoreDirectory = "assetStore";
+std::unordered_map<string, AssetHolder::BlobVerdict> AssetHolder::verifiedBlobs;
+std::atomic<uint64_t> AssetHolder::verificationPass{0};
+std::mutex AssetHolder::blobMutex;
+std::condition_variable AssetHolder::blobHashed;
+
+
+void AssetHolder::setContentAddressedStorage(bool enabled, const string & storeDirectory){
+	contentAddressed = enabled;
+	contentStoreDirectory = ofFilePath::addTrailingSlash(storeDirectory);
+	if(enabled){
+		ofDirectory::createDirectory(contentStoreDirectory, true, true);
+	}
+}
+
+
+string AssetHolder::blobPathFor(const ofxAssets::Descriptor & d){
+	string blob = contentStoreDirectory + ofxAssets::Hasher::normalizedChecksum(d.checksum, d.checksumType);
+	if(d.extension.size()) blob += "." + ofToLower(d.extension);
+	return blob;
+}
+
+
+static bool linkOrCopy(const string & from, const string & to){ //both relative to data
+	std::error_code err;
+	std::filesystem::path src = ofToDataPath(from, true);
+	std::filesystem::path dst = ofToDataPath(to, true);
+	std::filesystem::create_directories(dst.parent_path(), err);
+	std::filesystem::remove(dst, err);
+	std::filesystem::create_hard_link(src, dst, err);
+	if(err){ //ie different volumes
+		err.clear();
+		std::filesystem::copy_file(src, dst, std::filesystem::copy_options::overwrite_existing, err);
+	}
+	if(err){
+		ofLogError("AssetHolder") << "Can't link \"" << to << "\" to \"" << from << "\": " << err.message();
+	}
+	return !err;
+}
+
+
+bool AssetHolder::checkFromContentStore(ofxAssets::Descriptor & d, ofxAssets::CheckCounters * counters){
+
+	string blob = blobPathFor(d);
+	std::error_code err;
+	std::filesystem::path blobAbs = ofToDataPath(blob, true);
+	std::filesystem::path fileAbs = ofToDataPath(d.relativePath, true);
+	if(!std::filesystem::exists(blobAbs, err)) return false; //regular check, and adopted if OK
+
+	bool fileExists = std::filesystem::exists(fileAbs, err);
+	if(fileExists && !std::filesystem::equivalent(fileAbs, blobAbs, err)){
+		return false; //some other file there, check it the regular way
+	}
+
+	//each blob is hashed once per pass, no matter how many assets (and check threads) point to it
+	bool ok = false;
+	bool hashIt = false;
+	uint64_t pass = verificationPass;
+	{
+		std::unique_lock<std::mutex> lock(blobMutex);
+		while(true){
+			auto it = verifiedBlobs.find(blob);
+			if(it == verifiedBlobs.end() || it->second.pass != pass){
+				verifiedBlobs[blob] = BlobVerdict{pass, true, false};
+				hashIt = true;
+				break;
+			}
+			if(!it->second.hashing){
+				ok = it->second.ok;
+				break;
+			}
+			blobHashed.wait(lock);
+		}
+	}
+
+	if(hashIt){
+		ofxAssets::Hasher hasher(d.checksumType);
+		bool readOK = readFileInBlocks(blob, [&](const char * data, size_t len){ hasher.update(data, len); }, counters);
+		ok = readOK && hasher.matches(d.checksum);
+		{
+			std::unique_lock<std::mutex> lock(blobMutex);
+			auto it = verifiedBlobs.find(blob);
+			if(it != verifiedBlobs.end() && it->second.hashing && it->second.pass == pass){ //still ours to settle
+				if(readOK){
+					it->second.hashing = false;
+					it->second.ok = ok;
+				}else{
+					verifiedBlobs.erase(it); //no verdict, the next one to ask tries again
+				}
+			}
+		}
+		blobHashed.notify_all();
+
+		if(!readOK){ //could be anything (EIO, permissions, gone mid read); don't judge the content on it
+			ofLogError("AssetHolder") << "Can't read blob \"" << blob << "\" for \"" << d.relativePath << "\"! leaving it unchecked";
+			d.status.localFileExists = fileExists;
+			d.status.checked = false;
+			if(counters) counters->numFiles++;
+			return true;
+		}
+	}
+
+	if(!ok){ //bad blob, drop it (and our link to it) so it gets downloaded again
+		ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' CORRUPT in content store! 💩 \"" + blob + "\"");
+		std::filesystem::remove(blobAbs, err);
+		if(fileExists) std::filesystem::remove(fileAbs, err);
+		std::unique_lock<std::mutex> lock(blobMutex);
+		verifiedBlobs.erase(blob);
+		return false;
+	}
+
+	if(!fileExists && !linkOrCopy(blob, d.relativePath)){
+		return false;
+	}
+
+	d.status.localFileExists = true;
+	d.status.checksumSupplied = true;
+	d.status.localFileChecksumChecked = true;
+	d.status.checksumMatch = true;
+	d.status.checked = true;
+	if(counters) counters->numFiles++;
+	ofxThreadSafeLog::one()->append(assetLogFile, "'" + string(d.url) + "' EXISTS in content store and Checksum OK 😄");
+	return true;
+}
+
+
+void AssetHolder::adoptIntoContentStore(const ofxAssets::Descriptor & d){ //d was just hashed OK
+
+	string blob = blobPathFor(d);
+	std::error_code err;
+	std::filesystem::path blobAbs = ofToDataPath(blob, true);
+	bool isOurFile = std::filesystem::exists(blobAbs, err) &&
+					 std::filesystem::equivalent(blobAbs, ofToDataPath(d.relativePath, true), err);
+	if(!isOurFile){
+		//no blob yet, or one we haven't hashed: ours is known good, so it becomes the blob. Others
+		//linked to the old one keep it, and find out whether it is any good when they are checked.
+		if(!linkOrCopy(d.relativePath, blob)) return;
+	}
+	{
+		std::unique_lock<std::mutex> lock(blobMutex);
+		verifiedBlobs[blob] = BlobVerdict{verificationPass, false, true};
+	}
+	blobHashed.notify_all(); //in case someone was waiting on a hash of the old blob
+}
+
+
+void AssetHolder::linkDuplicatesFromContentStore(){
+
+	for(auto & it : assets){
+		ofxAssets::Descriptor & d = it.second;
+		if(d.location != ofxAssets::REMOTE || !d.hasChecksum() || isReadyToUse(d)) continue;
+		string blob = blobPathFor(d);
+		blobMutex.lock();
+		auto v = verifiedBlobs.find(blob);
+		bool ok = v != verifiedBlobs.end() && v->second.pass == verificationPass && !v->second.hashing && v->second.ok;
+		blobMutex.unlock();
+		if(ok && linkOrCopy(blob, d.relativePath)){
+			d.status.localFileExists = d.status.checksumSupplied = d.status.localFileChecksumChecked = true;
+			d.status.checksumMatch = true;
+			d.status.fileTooSmall = false;
+			d.status.checked = true;
+			packedStatusDirty = true;
+		}
+	}
+}
+
+
+bool AssetHolder::isDuplicateContent(const ofxAssets::Descriptor & d, const vector<string> & checksumsToDownload){
+	if(!contentAddressed || d.checksum.empty()) return false;
+	for(auto & c : checksumsToDownload){
+		if(ofxAssets::Hasher::checksumsMatch(c, d.checksum, d.checksumType)) return true;
+	}
+	return false;
+}
@@ -96,6 +96,21 @@ namespace ofxAssets{
 		}
 	};
 
+	struct ChunkManifest{ //optional per-chunk checksums, lets us find (and re-download) only the corrupt parts of a file
+		uint64_t fileSize;
+		uint64_t chunkSize;
+		vector<string> chunkChecksums; //Merkle leaves, same checksum type as the whole file, in file order
+
+		ChunkManifest(){
+			fileSize = chunkSize = 0;
+		}
+
+		size_t getNumChunks() const{return chunkSize ? (fileSize + chunkSize - 1) / chunkSize : 0;}
+		bool isValid() const{return fileSize > 0 && chunkSize > 0 && chunkChecksums.size() == getNumChunks();}
+		uint64_t getChunkOffset(size_t i) const{return i * chunkSize;}
+		uint64_t getChunkLength(size_t i) const{return std::min(chunkSize, fileSize - i * chunkSize);}
+	};
+
 	struct UserInfo{
 		string title;
 		bool hasSubtitles;
@@ -105,6 +120,15 @@ namespace ofxAssets{
 		map<string, string> extra;
 	};
 
+	enum StatusBit{ //LocalAssetStatus packed into a byte, only what the Usage/Download policies look at
+		STATUS_CHECKED = 1 << 0,
+		STATUS_FILE_EXISTS = 1 << 1,
+		STATUS_CHECKSUM_SUPPLIED = 1 << 2,
+		STATUS_CHECKSUM_MATCH = 1 << 3,
+		STATUS_FILE_TOO_SMALL = 1 << 4,
+		NUM_STATUS_COMBINATIONS = 1 << 5
+	};
+
 	struct LocalAssetStatus{
 		bool localFileExists;
 		bool checksumSupplied;
@@ -116,12 +140,60 @@ namespace ofxAssets{
 		bool downloaded; 
 		bool downloadOK;
 
+		vector<size_t> corruptChunks; //only filled in if the Descriptor has a valid ChunkManifest
+		bool headerMismatch; //the file's headers say it's not what its extension says (see AssetHolder::setProbeHeaders())
+
 		LocalAssetStatus(){
 			localFileChecksumChecked = localFileExists = checksumMatch = false;
 			downloaded = downloadOK = fileTooSmall = checksumSupplied = checked = false;
+			headerMismatch = false;
+		}
+
+		uint8_t pack() const{
+			return	(checked ? STATUS_CHECKED : 0) |
+					(localFileExists ? STATUS_FILE_EXISTS : 0) |
+					(checksumSupplied ? STATUS_CHECKSUM_SUPPLIED : 0) |
+					(checksumMatch ? STATUS_CHECKSUM_MATCH : 0) |
+					(fileTooSmall ? STATUS_FILE_TOO_SMALL : 0);
+		}
+
+		static LocalAssetStatus unpack(uint8_t bits){
+			LocalAssetStatus s;
+			s.checked = bits & STATUS_CHECKED;
+			s.localFileExists = bits & STATUS_FILE_EXISTS;
+			s.checksumSupplied = bits & STATUS_CHECKSUM_SUPPLIED;
+			s.checksumMatch = bits & STATUS_CHECKSUM_MATCH;
+			s.fileTooSmall = bits & STATUS_FILE_TOO_SMALL;
+			return s;
 		}
 	};
 
+	struct CheckCounters{ //updated by AssetHolder::updateLocalAssetsStatus() as it goes, read them from any thread
+		std::atomic<uint64_t> numFiles;
+		std::atomic<uint64_t> numBytes; //read from disk to be hashed, counted per block
+		std::atomic<uint64_t> totalFiles; //from the stat pass (AssetHolder::addToCheckTotals()), if any
+		std::atomic<uint64_t> totalBytes;
+		CheckCounters(){
+			reset();
+		}
+		void reset(){
+			numFiles = numBytes = totalFiles = totalBytes = 0;
+		}
+	};
+
+	struct CheckProgress{ //a snapshot, see AssetChecker::getProgressSnapshot()
+		uint64_t numFiles = 0;
+		uint64_t numBytes = 0;
+		uint64_t totalFiles = 0;
+		uint64_t totalBytes = 0;
+		bool totalsKnown = false; //stat pass done; until then totals keep growing
+		float progress = 0; //0..1, byte weighted (opening a file counts as reading 64KB)
+		float bytesPerSecond = 0;
+		float filesPerSecond = 0;
+		float elapsed = 0; //seconds
+		float eta = -1; //seconds, -1 if we can't tell yet
+	};
+
 	struct Descriptor{
 
 		string fileName;
@@ -138,6 +210,10 @@ namespace ofxAssets{
 		UserInfo userInfo;
 		Specs specs;
 		LocalAssetStatus status;
+		ChunkManifest chunks;
+
+		string packFile; //if set, this asset is the entry packEntry of this AssetPack (relative to data)
+		string packEntry;
 
 		Descriptor(){
 			type = TYPE_UNKNOWN;
@@ -145,5 +221,6 @@ namespace ofxAssets{
 		}
 
 		bool hasChecksum(){return checksum.size() > 0;}
+		bool isPacked() const {return packFile.size() > 0;}
 	};
 }
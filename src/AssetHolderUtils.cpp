@@ -9,6 +9,7 @@
 #include "AssetHolder.h"
 
 bool AssetHolder::localAssetExistsInDB(const string& relativePath){
+	ensureResident();
 	auto it = assets.find(relativePath);
 	return it != assets.end();
 }
@@ -16,6 +17,7 @@ bool AssetHolder::localAssetExistsInDB(const string& relativePath){
 
 bool AssetHolder::remoteAssetExistsInDB(const string& url){
 
+	ensureResident();
 	auto it = assets.begin();
 	while( it != assets.end()){
 		if(it->second.url == url){
@@ -29,6 +31,9 @@ bool AssetHolder::remoteAssetExistsInDB(const string& url){
 
 ofxAssets::Descriptor&
 AssetHolder::getAssetDescForPath(const string& relativePath){ //relative to data
+	ensureResident();
+	packedStatusDirty = true; //you might change its status through the reference
+	variantsDirty = true; //or its specs
 	auto it = assets.find(relativePath);
 	if(it != assets.end()){
 		return it->second;
@@ -39,6 +44,9 @@ AssetHolder::getAssetDescForPath(const string& relativePath){ //relative to data
 
 ofxAssets::Descriptor&
 AssetHolder::getAssetDescForURL(const string& url){
+	ensureResident();
+	packedStatusDirty = true; //you might change its status through the reference
+	variantsDirty = true; //or its specs
 	auto it = assets.begin();
 	while( it != assets.end()){
 		if(it->second.url == url){
@@ -53,6 +61,7 @@ AssetHolder::getAssetDescForURL(const string& url){
 vector<ofxAssets::Descriptor>
 AssetHolder::getAssetDescriptorsForType(ofxAssets::Type type){
 
+	ensureResident();
 	vector<ofxAssets::Descriptor> retAssets;
 	auto it = assets.begin();
 	while( it != assets.end()){
@@ -67,6 +76,7 @@ AssetHolder::getAssetDescriptorsForType(ofxAssets::Type type){
 
 void AssetHolder::addTagsforAsset(const string & relPath, vector<string> tags){
 
+	ensureResident();
 	auto it = assets.find(relPath);
 	if(it != assets.end()){
 		for(auto & tag : tags){
@@ -80,6 +90,7 @@ void AssetHolder::addTagsforAsset(const string & relPath, vector<string> tags){
 vector<ofxAssets::Descriptor>
 AssetHolder::getAssetDescsWithTag(const string & tag){
 
+	ensureResident();
 	vector<ofxAssets::Descriptor> ads;
 	vector<string> paths = tags.getObjectsWithTag(Tag<TagCategory>(tag, CATEGORY));
 	for(auto & path : paths){
@@ -94,6 +105,8 @@ AssetHolder::getAssetDescsWithTag(const string & tag){
 ofxAssets::UserInfo&
 AssetHolder::getUserInfoForPath(const string& relpath){
 
+	ensureResident();
+	variantsDirty = true; //you might change its ID / size through the reference
 	auto it = assets.find(relpath);
 	if(it != assets.end()){
 		return it->second.userInfo;
@@ -118,6 +131,9 @@ string AssetHolder::toString(ofxAssets::Stats &s){
 
 ofxAssets::Descriptor&
 AssetHolder::getAssetDescAtIndex(int i){
+	ensureResident();
+	packedStatusDirty = true; //you might change its status through the reference
+	variantsDirty = true; //or its specs
 
 	if(i >= 0 && i < assetAddOrder.size()){
 		return assets[assetAddOrder[i]];
@@ -127,106 +143,115 @@ AssetHolder::getAssetDescAtIndex(int i){
 
 
 int AssetHolder::getNumAssets(){
-	return assets.size();
+	return pagedOut ? numPagedOutAssets : assets.size();
 }
 
-ofxAssets::Type
-AssetHolder::typeFromExtension(const string& extension){
-
-	ofxAssets::Type type = ofxAssets::TYPE_UNKNOWN;
-
-	string lce = ofToLower(extension);
-	if(lce == "jpg" || lce == "jpeg" || lce == "png" || lce == "gif" || lce == "tiff" ||
-	   lce == "tga" || lce == "bmp"){
-		type = ofxAssets::IMAGE;
-	}
-	else if(lce == "mov" || lce == "mp4" || lce == "avi" || lce == "mpg" || lce == "mpeg" ||
-			lce == "mkv" || lce == "vob" || lce == "qt" || lce == "wmv" || lce == "m4v" ||
-			lce == "mp2" || lce == "m2v" || lce == "m4v"){
-		type = ofxAssets::VIDEO;
-	}
-	else if (lce == "aif" || lce == "aiff" || lce == "mp3" || lce == "wav" || lce == "mp4" ||
-			 lce == "aac" || lce == "flac" || lce == "m4a" || lce == "wma"){
-		type = ofxAssets::AUDIO;
-	}
-	else if (lce == "json"){
-		type = ofxAssets::JSON;
-	}
-	else if (lce == "txt" || lce == "log"){
-		type = ofxAssets::TEXT;
-	}
-	else if (lce == "ttf" || lce == "otf"){
-		type = ofxAssets::FONT;
-	}else{
-		ofLogError("AssetHolder") << "Can't recognize Asset Type from file extension: \"" << extension << "\"";
-	}
-	return type;
-}
+//extension -> type table, looked up without lowercasing into a new string
+namespace{
 
-
-bool AssetHolder::shouldDownload(const ofxAssets::Descriptor &d){
-
-	bool shouldDownload = false;
-	//lets see if we should download this asset
-	if(d.status.checked){
-		if(downloadPolicy.fileMissing && !d.status.localFileExists) return true;
-		if(downloadPolicy.fileExistsAndNoChecksumProvided && !d.status.checksumSupplied) return true;
-		if(downloadPolicy.fileExistsAndProvidedChecksumMissmatch && d.status.checksumSupplied && !d.status.checksumMatch) return true;
-		if(downloadPolicy.fileExistsAndProvidedChecksumMatch && d.status.checksumSupplied && !d.status.checksumMatch) return true;
-		if(!d.status.checksumMatch && d.status.checksumSupplied){ //if we have a sha1 match - file size is irrelevant so no more tests to run
-			if(downloadPolicy.fileTooSmall && d.status.fileTooSmall) return true;
+	struct CaseInsensitiveHash{
+		size_t operator()(const string & s) const{
+			size_t h = 14695981039346656037ULL; //FNV-1a
+			for(char c : s){
+				h ^= (unsigned char)tolower((unsigned char)c);
+				h *= 1099511628211ULL;
+			}
+			return h;
 		}
+	};
 
-	}else{
-		ofLogError("AssetHolder") << "cant decide wether to download or not - havent checked for local files yet!";
+	struct CaseInsensitiveEqual{
+		bool operator()(const string & a, const string & b) const{
+			if(a.size() != b.size()) return false;
+			for(size_t i = 0; i < a.size(); i++){
+				if(tolower((unsigned char)a[i]) != tolower((unsigned char)b[i])) return false;
+			}
+			return true;
+		}
+	};
+
+	struct ExtensionInfo{
+		ofxAssets::Type type;
+		bool ambiguous; //ie mp4, can be video or audio
+	};
+
+	typedef std::unordered_map<string, ExtensionInfo, CaseInsensitiveHash, CaseInsensitiveEqual> ExtensionTable;
+
+	ExtensionTable & extensionTable(){
+		static ExtensionTable table = [](){
+			ExtensionTable t;
+			for(auto e : {"jpg", "jpeg", "png", "gif", "tiff", "tif", "tga", "bmp", "webp"}) t[e] = {ofxAssets::IMAGE, false};
+			for(auto e : {"mov", "avi", "mpg", "mpeg", "mkv", "vob", "qt", "wmv", "m4v", "mp2", "m2v", "ogv"}) t[e] = {ofxAssets::VIDEO, false};
+			for(auto e : {"aif", "aiff", "mp3", "wav", "aac", "flac", "m4a", "wma", "oga", "opus"}) t[e] = {ofxAssets::AUDIO, false};
+			t["mp4"] = {ofxAssets::VIDEO, true};
+			t["webm"] = {ofxAssets::VIDEO, true};
+			t["ogg"] = {ofxAssets::AUDIO, true};
+			t["json"] = {ofxAssets::JSON, false};
+			for(auto e : {"txt", "log"}) t[e] = {ofxAssets::TEXT, false};
+			for(auto e : {"ttf", "otf"}) t[e] = {ofxAssets::FONT, false};
+			return t;
+		}();
+		return table;
 	}
-	return shouldDownload;
-}
 
-bool AssetHolder::isReadyToUse(const ofxAssets::Descriptor &d){
+	std::mutex unknownExtensionsMutex;
+	std::unordered_map<string, bool, CaseInsensitiveHash, CaseInsensitiveEqual> unknownExtensions; //so we only complain once
+}
 
-	bool isOKtoUse = false;
 
-	//lets see if we should use this asset
-	if(d.status.checked){
+void AssetHolder::registerExtension(const string & extension, ofxAssets::Type type, bool ambiguous){
+	extensionTable()[extension] = {type, ambiguous};
+}
 
 
-		if(!d.status.checksumSupplied){ //no checksum is used
+ofxAssets::Type
+AssetHolder::typeFromExtension(const string& extension){
 
-			bool checksumOK = d.status.checksumMatch;
-			if(assetOkPolicy.fileExistsAndNoChecksumProvided) checksumOK = true;
+	const ExtensionTable & table = extensionTable();
+	auto it = table.find(extension);
+	if(it != table.end()){
+		return it->second.type;
+	}
+	std::unique_lock<std::mutex> lock(unknownExtensionsMutex);
+	if(unknownExtensions.emplace(extension, true).second){
+		ofLogWarning("AssetHolder") << "Can't recognize Asset Type from file extension: \"" << extension << "\"";
+	}
+	return ofxAssets::TYPE_UNKNOWN;
+}
 
-			bool fileSizeOK = !d.status.fileTooSmall;
-			if(assetOkPolicy.fileTooSmall) fileSizeOK = true;
 
-			bool fileExistsOK = d.status.localFileExists;
-			if(assetOkPolicy.fileMissing) fileExistsOK = true;
+bool AssetHolder::isAmbiguousExtension(const string& extension){
+	const ExtensionTable & table = extensionTable();
+	auto it = table.find(extension);
+	return it != table.end() && it->second.ambiguous;
+}
 
-			isOKtoUse = fileSizeOK && fileExistsOK && checksumOK;
 
-		}else{ //ckecksum is USED
+bool AssetHolder::shouldDownload(const ofxAssets::Descriptor &d){
+	if(!d.status.checked){
+		ofLogError("AssetHolder") << "cant decide wether to download or not - havent checked for local files yet!";
+	}
+	return compiledPolicy.shouldDownload(d.status.pack());
+}
 
-			bool useIf_exists = (d.status.localFileExists || assetOkPolicy.fileMissing);
-			bool useIf_sha1_exists = (assetOkPolicy.fileExistsAndNoChecksumProvided || d.status.checksumSupplied);
+bool AssetHolder::isReadyToUse(const ofxAssets::Descriptor &d){
+	if(!d.status.checked){
+		ofLogError("AssetHolder") << "cant decide wether to USE or not - havent checked for local files yet!";
+	}
+	return compiledPolicy.isReadyToUse(d.status.pack());
+}
 
-			bool useIf_sha1;
-			if(assetOkPolicy.fileExistsAndProvidedChecksumMatch){
-				useIf_sha1 = d.status.checksumMatch;
-			}else{
-				useIf_sha1 = d.status.checksumMatch || assetOkPolicy.fileExistsAndProvidedChecksumMissmatch;
-			}
 
-			bool useIf_tooSmall;
-			if(!d.status.fileTooSmall){
-				useIf_tooSmall = true;
-			}else{ //too small!
-				useIf_tooSmall = assetOkPolicy.fileTooSmall;
-			}
-			isOKtoUse = useIf_tooSmall && useIf_sha1 && useIf_sha1_exists && useIf_exists;
-		}
+void AssetHolder::updatePackedStatus(){
 
-	}else{
-		ofLogError("AssetHolder") << "cant decide wether to USE or not - havent checked for local files yet!";
+	if(!packedStatusDirty) return;
+	ensureResident();
+	packedStatus.resize(assetAddOrder.size());
+	numUncheckedAssets = 0;
+	for(auto & it : assetAddOrder){
+		uint8_t bits = assets[it.second].status.pack();
+		packedStatus[it.first] = bits;
+		numUncheckedAssets += (bits & ofxAssets::STATUS_CHECKED) ? 0 : 1;
 	}
-	return isOKtoUse;
+	packedStatusDirty = false;
 }
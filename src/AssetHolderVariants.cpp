@@ -0,0 +1,99 @@
+//
+//  AssetHolderVariants.cpp
+//  ofxAssets
+//
+//	size variants of the same logical asset (ie "_o" original, "_b" big...), indexed so picking
+//	the right one doesn't mean scanning all assets.
+//
+
+#include "AssetHolder.h"
+
+
+string AssetHolder::variantGroupFor(const ofxAssets::Descriptor & d){
+
+	if(d.userInfo.ID.size()) return d.userInfo.ID;
+
+	string base = ofFilePath::removeExt(d.fileName);
+	const string & suffix = d.userInfo.size;
+	if(suffix.size() && base.size() > suffix.size() &&
+	   base.compare(base.size() - suffix.size(), suffix.size(), suffix) == 0){
+		base.erase(base.size() - suffix.size());
+	}
+	//keep the directory, so "a/1234_b.jpg" and "b/1234_b.jpg" are not variants of each other
+	size_t slash = d.relativePath.find_last_of("/\\");
+	return (slash == string::npos ? "" : d.relativePath.substr(0, slash + 1)) + base;
+}
+
+
+void AssetHolder::buildVariantIndex(){
+
+	ensureResident();
+	variants.clear();
+	variantGroups.clear();
+
+	for(auto & it : assetAddOrder){
+		const ofxAssets::Descriptor & d = assets[it.second];
+		string group = variantGroupFor(d);
+		variants[group].push_back(d.relativePath);
+		variantGroups[d.relativePath] = group;
+	}
+
+	//smallest first, unknown sizes (0) last
+	auto area = [this](const string & relPath) -> uint64_t{
+		const ofxAssets::Specs & s = assets[relPath].specs;
+		uint64_t a = (uint64_t)std::max(s.width, 0) * (uint64_t)std::max(s.height, 0);
+		return a > 0 ? a : std::numeric_limits<uint64_t>::max();
+	};
+	for(auto & it : variants){
+		if(it.second.size() < 2) continue;
+		std::stable_sort(it.second.begin(), it.second.end(), [&area](const string & a, const string & b){
+			return area(a) < area(b);
+		});
+	}
+	variantsDirty = false;
+}
+
+
+string AssetHolder::getVariantGroup(const string & relativePath){
+	if(variantsDirty) buildVariantIndex();
+	auto it = variantGroups.find(relativePath);
+	return it != variantGroups.end() ? it->second : "";
+}
+
+
+vector<string> AssetHolder::getVariants(const string & group){
+	if(variantsDirty) buildVariantIndex();
+	auto it = variants.find(group);
+	return it != variants.end() ? it->second : vector<string>();
+}
+
+
+string AssetHolder::bestVariantFor(const string & group, int targetW, int targetH){
+
+	if(variantsDirty) buildVariantIndex();
+
+	auto it = variants.find(group);
+	if(it == variants.end()){ //maybe it's one of the variants
+		auto g = variantGroups.find(group);
+		if(g == variantGroups.end()){
+			ofLogError("AssetHolder") << "bestVariantFor() no such asset or variant group! '" << group << "'";
+			return "";
+		}
+		it = variants.find(g->second);
+	}
+
+	string biggestReady, unsizedReady;
+	for(auto & relPath : it->second){ //smallest first, so the first one that's big enough is it
+		const ofxAssets::Descriptor & d = assets[relPath];
+		if(!isReadyToUse(d)) continue;
+		if(d.specs.width <= 0 || d.specs.height <= 0){
+			if(unsizedReady.empty()) unsizedReady = relPath;
+			continue;
+		}
+		if(d.specs.width >= targetW && d.specs.height >= targetH){
+			return relPath;
+		}
+		biggestReady = relPath;
+	}
+	return biggestReady.size() ? biggestReady : unsizedReady;
+}
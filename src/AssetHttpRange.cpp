@@ -0,0 +1,201 @@
+//
+//  AssetHttpRange.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetHttpRange.h"
+
+#include "Poco/URI.h"
+#include "Poco/Net/HTTPClientSession.h"
+#include "Poco/Net/HTTPSClientSession.h"
+#include "Poco/Net/HTTPRequest.h"
+#include "Poco/Net/HTTPResponse.h"
+#include "Poco/Net/Context.h"
+
+using namespace ofxAssets;
+
+
+static std::unique_ptr<Poco::Net::HTTPClientSession> openSession(const Poco::URI & uri, int timeoutSeconds){
+
+	std::unique_ptr<Poco::Net::HTTPClientSession> session;
+	if(uri.getScheme() == "https"){
+		Poco::Net::Context::Ptr context = new Poco::Net::Context(Poco::Net::Context::CLIENT_USE, "", "", "",
+																 Poco::Net::Context::VERIFY_RELAXED, 9, true);
+		session.reset(new Poco::Net::HTTPSClientSession(uri.getHost(), uri.getPort(), context));
+	}else{
+		session.reset(new Poco::Net::HTTPClientSession(uri.getHost(), uri.getPort()));
+	}
+	session->setTimeout(Poco::Timespan(timeoutSeconds, 0));
+	return session;
+}
+
+
+static string pathForRequest(const Poco::URI & uri){
+	string path = uri.getPathAndQuery();
+	if(path.empty()) path = "/";
+	return path;
+}
+
+
+static const int maxRedirects = 5;
+
+//GET url with an optional Range header, following up to maxRedirects redirects (ie CDNs). session
+//must outlive the returned stream. Throws like Poco does; error is set on too many redirects.
+static std::istream * get(const string & url, const string & range, int timeoutSeconds,
+						  std::unique_ptr<Poco::Net::HTTPClientSession> & session,
+						  Poco::Net::HTTPResponse & response, string & error){
+
+	Poco::URI uri(url);
+	for(int i = 0; i <= maxRedirects; i++){
+		session = openSession(uri, timeoutSeconds);
+		Poco::Net::HTTPRequest request(Poco::Net::HTTPRequest::HTTP_GET, pathForRequest(uri), Poco::Net::HTTPMessage::HTTP_1_1);
+		if(range.size()) request.set("Range", range);
+		session->sendRequest(request);
+
+		std::istream & rs = session->receiveResponse(response);
+		int status = (int)response.getStatus();
+		bool redirect = status == 301 || status == 302 || status == 303 || status == 307 || status == 308;
+		if(!redirect || !response.has("Location")){
+			return &rs;
+		}
+		uri = Poco::URI(uri, response.get("Location")); //can be relative
+	}
+	error = "too many redirects (more than " + ofToString(maxRedirects) + ")";
+	return nullptr;
+}
+
+
+//"bytes 100-199/200" >> 100, 199, 200 (total 0 if "*")
+static bool parseContentRange(const string & cr, uint64_t & first, uint64_t & last, uint64_t & total){
+	unsigned long long a = 0, b = 0, t = 0;
+	total = 0;
+	if(sscanf(cr.c_str(), "bytes %llu-%llu/%llu", &a, &b, &t) == 3){
+		total = t;
+	}else if(sscanf(cr.c_str(), "bytes %llu-%llu/*", &a, &b) != 2){
+		return false;
+	}
+	first = a; last = b;
+	return b >= a;
+}
+
+
+bool HttpRange::fetch(const string & url, uint64_t offset, uint64_t length, string & data, string & error,
+					  int timeoutSeconds){
+
+	data.clear();
+	error.clear();
+	if(length == 0) return true;
+
+	try{
+		std::unique_ptr<Poco::Net::HTTPClientSession> session;
+		Poco::Net::HTTPResponse response;
+		std::istream * rsp = get(url, "bytes=" + ofToString(offset) + "-" + ofToString(offset + length - 1),
+								 timeoutSeconds, session, response, error);
+		if(!rsp) return false;
+		std::istream & rs = *rsp;
+
+		if(response.getStatus() != Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT){
+			error = "server replied " + ofToString((int)response.getStatus()) + " \"" + response.getReason() + "\" to a Range request";
+			return false;
+		}
+
+		//a server that shifts or ignores the range would have us patch the wrong bytes
+		uint64_t first = 0, last = 0, total = 0;
+		if(!response.has("Content-Range") || !parseContentRange(response.get("Content-Range"), first, last, total) ||
+		   first != offset || last != offset + length - 1){
+			error = "server replied with range \"" + (response.has("Content-Range") ? response.get("Content-Range") : string()) +
+					"\" to a request for bytes " + ofToString(offset) + "-" + ofToString(offset + length - 1);
+			return false;
+		}
+
+		data.resize(length);
+		rs.read(&data[0], length);
+		if((uint64_t)rs.gcount() != length){
+			error = "got " + ofToString(rs.gcount()) + " bytes, expected " + ofToString(length);
+			data.clear();
+			return false;
+		}
+		return true;
+
+	}catch(Poco::Exception & e){
+		error = e.displayText();
+	}catch(std::exception & e){
+		error = e.what();
+	}
+	data.clear();
+	return false;
+}
+
+
+bool HttpRange::fetchFrom(const string & url, uint64_t offset, std::function<bool(const char *, size_t)> onData,
+						  uint64_t & totalSize, bool & rangeHonored, string & error, int timeoutSeconds){
+
+	error.clear();
+	totalSize = 0;
+	rangeHonored = false;
+
+	try{
+		std::unique_ptr<Poco::Net::HTTPClientSession> session;
+		Poco::Net::HTTPResponse response;
+		std::istream * rsp = get(url, offset > 0 ? "bytes=" + ofToString(offset) + "-" : "",
+								 timeoutSeconds, session, response, error);
+		if(!rsp) return false;
+		std::istream & rs = *rsp;
+
+		int64_t contentLength = response.getContentLength64(); //-1 if unknown
+		if(response.getStatus() == Poco::Net::HTTPResponse::HTTP_PARTIAL_CONTENT){
+			uint64_t first = 0, last = 0;
+			if(response.has("Content-Range") && !parseContentRange(response.get("Content-Range"), first, last, totalSize)){
+				error = "can't parse Content-Range \"" + response.get("Content-Range") + "\"";
+				return false;
+			}
+			if(response.has("Content-Range") && first != offset){ //appending it at offset would corrupt the file
+				error = "asked for bytes from " + ofToString(offset) + ", server replied \"" + response.get("Content-Range") + "\"";
+				return false;
+			}
+			rangeHonored = true;
+			if(totalSize == 0 && contentLength >= 0) totalSize = offset + contentLength;
+		}else if(response.getStatus() == Poco::Net::HTTPResponse::HTTP_OK){
+			rangeHonored = offset == 0;
+			if(contentLength >= 0) totalSize = contentLength;
+		}else if(response.getStatus() == Poco::Net::HTTPResponse::HTTP_REQUESTED_RANGE_NOT_SATISFIABLE && offset > 0){
+			//we already have it all (or more than there is); "bytes */200" tells how much there is
+			rangeHonored = true;
+			if(response.has("Content-Range")){
+				unsigned long long t = 0;
+				if(sscanf(response.get("Content-Range").c_str(), "bytes */%llu", &t) == 1) totalSize = t;
+			}
+			return true;
+		}else{
+			error = "server replied " + ofToString((int)response.getStatus()) + " \"" + response.getReason() + "\"";
+			return false;
+		}
+
+		uint64_t expected = (contentLength >= 0) ? (uint64_t)contentLength : 0;
+		uint64_t received = 0;
+		vector<char> buffer(256 * 1024);
+		while(rs){
+			rs.read(buffer.data(), buffer.size());
+			std::streamsize n = rs.gcount();
+			if(n > 0){
+				received += n;
+				if(!onData(buffer.data(), (size_t)n)){
+					error = "canceled";
+					return false;
+				}
+			}
+		}
+		if(contentLength >= 0 && received != expected){
+			error = "connection dropped after " + ofToString(received) + " of " + ofToString(expected) + " bytes";
+			return false;
+		}
+		return true;
+
+	}catch(Poco::Exception & e){
+		error = e.displayText();
+	}catch(std::exception & e){
+		error = e.what();
+	}
+	return false;
+}
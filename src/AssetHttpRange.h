@@ -0,0 +1,30 @@
+//
+//  AssetHttpRange.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+//minimal blocking HTTP/HTTPS client for partial requests (HTTP Range); ofxDownloadCentral can
+//only fetch whole files. Follows up to 5 redirects. Call from a worker thread.
+namespace ofxAssets{
+
+	namespace HttpRange{
+
+		//GET bytes [offset, offset + length) of url. Fails unless the server replies 206 with
+		//a Content-Range for exactly those bytes, and sends them all.
+		bool fetch(const string & url, uint64_t offset, uint64_t length, string & data, string & error,
+				   int timeoutSeconds = 30);
+
+		//GET url from offset to the end, handing over the body as it arrives. rangeHonored comes back
+		//false if the server ignored the Range header and is sending the whole file from byte 0.
+		//totalSize is the full file size (0 if the server didnt say). onData can return false to abort.
+		//Fails if the server replies 206 for a range that doesn't start at offset. A 416 (offset is at or
+		//past the end) succeeds with no data; totalSize tells if we really had it all (0 if unknown).
+		bool fetchFrom(const string & url, uint64_t offset, std::function<bool(const char *, size_t)> onData,
+					   uint64_t & totalSize, bool & rangeHonored, string & error, int timeoutSeconds = 30);
+	}
+}
@@ -0,0 +1,262 @@
+//
+//  AssetImagePreloader.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetImagePreloader.h"
+#include "AssetHolder.h"
+
+
+AssetImagePreloader::~AssetImagePreloader(){
+	stop();
+}
+
+
+void AssetImagePreloader::setup(int numThreads, size_t memoryBudget){
+
+	stop();
+	mutex.lock();
+	stopping = false;
+	budget = memoryBudget;
+	evictUntilFits(0);
+	mutex.unlock();
+
+	for(int i = 0; i < std::max(1, numThreads); i++){
+		DecodeThread * t = new DecodeThread();
+		t->preloader = this;
+		threads.emplace_back(t);
+		t->startThread();
+	}
+}
+
+
+void AssetImagePreloader::stop(){
+
+	mutex.lock();
+	stopping = true;
+	jobs = std::priority_queue<Job>();
+	mutex.unlock();
+	jobAvailable.notify_all();
+
+	for(auto & t : threads){
+		t->waitForThread(false);
+	}
+	threads.clear();
+
+	mutex.lock();
+	queuedOrDecoding.clear();
+	mutex.unlock();
+}
+
+
+void AssetImagePreloader::setTagPriority(const string & tag, int priority){
+	ofScopedLock lock(mutex);
+	tagPriorities[tag] = priority;
+}
+
+
+void AssetImagePreloader::setHolderPriority(AssetHolder * holder, int priority){
+	ofScopedLock lock(mutex);
+	holderPriorities[holder] = priority;
+}
+
+
+void AssetImagePreloader::addHolder(AssetHolder * holder){
+
+	mutex.lock();
+	if(stopping){
+		mutex.unlock();
+		ofLogError("AssetImagePreloader") << "Stopped! call setup() again before adding AssetHolders";
+		return;
+	}
+	int holderPriority = 0;
+	auto hp = holderPriorities.find(holder);
+	if(hp != holderPriorities.end()) holderPriority = hp->second;
+	std::map<string, int> tagPrios = tagPriorities;
+	mutex.unlock();
+
+	//find out the priority of each asset according to its tags
+	std::unordered_map<string, int> assetPriorities;
+	for(auto & it : tagPrios){
+		vector<ofxAssets::Descriptor> tagged = holder->getAssetDescsWithTag(it.first);
+		for(auto & d : tagged){
+			auto ap = assetPriorities.find(d.relativePath);
+			if(ap == assetPriorities.end()){
+				assetPriorities[d.relativePath] = it.second;
+			}else{
+				ap->second = std::max(ap->second, it.second);
+			}
+		}
+	}
+
+	vector<Job> newJobs;
+	vector<ofxAssets::Descriptor> images = holder->getAssetDescriptorsForType(ofxAssets::IMAGE);
+	for(auto & d : images){
+		if(!d.status.checked || !holder->isAssetReadyToUse(d.relativePath)) continue;
+		Job j;
+		j.relativePath = d.relativePath;
+		j.packFile = d.packFile;
+		j.packEntry = d.packEntry;
+		j.priority = holderPriority;
+		auto ap = assetPriorities.find(d.relativePath);
+		if(ap != assetPriorities.end()) j.priority = std::max(j.priority, ap->second);
+		newJobs.push_back(j);
+	}
+
+	mutex.lock();
+	int numAdded = 0;
+	if(stopping) newJobs.clear(); //stopped while we were looking
+	for(auto & j : newJobs){
+		if(cache.find(j.relativePath) != cache.end()) continue; //already decoded
+		if(!queuedOrDecoding.insert(j.relativePath).second) continue; //already on its way
+		j.order = jobCounter++;
+		jobs.push(j);
+		numAdded++;
+	}
+	mutex.unlock();
+
+	if(numAdded == 1) jobAvailable.notify_one();
+	else if(numAdded > 1) jobAvailable.notify_all();
+}
+
+
+std::shared_ptr<const ofPixels> AssetImagePreloader::tryGetPixels(const string & relativePath){
+
+	ofScopedLock lock(mutex);
+	auto it = cache.find(relativePath);
+	if(it != cache.end()){
+		lru.splice(lru.begin(), lru, it->second.lruPos); //mark as recently used
+		return it->second.pixels;
+	}
+	return nullptr;
+}
+
+
+void AssetImagePreloader::evict(const string & relativePath){
+	ofScopedLock lock(mutex);
+	auto it = cache.find(relativePath);
+	if(it != cache.end()){
+		used -= it->second.numBytes;
+		lru.erase(it->second.lruPos);
+		cache.erase(it);
+	}
+}
+
+
+void AssetImagePreloader::clear(){
+	ofScopedLock lock(mutex);
+	jobs = std::priority_queue<Job>();
+	queuedOrDecoding.clear();
+	cache.clear();
+	lru.clear();
+	used = 0;
+}
+
+
+size_t AssetImagePreloader::getMemoryUsed(){
+	ofScopedLock lock(mutex);
+	return used;
+}
+
+
+int AssetImagePreloader::getNumPending(){
+	ofScopedLock lock(mutex);
+	return queuedOrDecoding.size();
+}
+
+
+bool AssetImagePreloader::waitForJob(Job & job){
+
+	std::unique_lock<std::mutex> lock(mutex);
+	jobAvailable.wait(lock, [this]{ return stopping || !jobs.empty(); });
+	if(stopping) return false;
+	job = jobs.top();
+	jobs.pop();
+	return true;
+}
+
+
+void AssetImagePreloader::decode(const Job & job){
+
+	std::shared_ptr<ofPixels> pixels = std::make_shared<ofPixels>();
+	bool ok;
+
+	//if the checker kept the bytes around, decode from those and dont touch the disk again; they
+	//are the app's, only released if it said so
+	std::shared_ptr<const ofBuffer> bytes = AssetHolder::getVerifiedBytes(job.relativePath);
+	if(bytes){
+		ok = ofLoadImage(*pixels, *bytes);
+		if(releaseVerifiedBytes) AssetHolder::releaseVerifiedBytes(job.relativePath);
+	}else if(job.packFile.size()){ //straight from the pack's mapping
+		auto pack = AssetPack::get(job.packFile);
+		AssetPack::Slice s = pack ? pack->getSlice(job.packEntry) : AssetPack::Slice();
+		ok = s.isValid() && ofLoadImage(*pixels, ofBuffer(s.data, s.size));
+	}else{
+		ok = ofLoadImage(*pixels, job.relativePath);
+	}
+
+	if(ok && pixels->isAllocated()){
+		storePixels(job.relativePath, pixels);
+	}else{
+		ofLogError("AssetImagePreloader") << "Failed to decode image \"" << job.relativePath << "\"";
+		ofScopedLock lock(mutex);
+		queuedOrDecoding.erase(job.relativePath);
+	}
+}
+
+
+void AssetImagePreloader::storePixels(const string & relativePath, std::shared_ptr<ofPixels> pixels){
+
+	ofScopedLock lock(mutex);
+	queuedOrDecoding.erase(relativePath);
+	size_t numBytes = pixels->getTotalBytes();
+
+	if(numBytes > budget){
+		ofLogWarning("AssetImagePreloader") << "\"" << relativePath << "\" doesn't fit in the memory budget, dropping it.";
+		return;
+	}
+
+	auto it = cache.find(relativePath);
+	if(it != cache.end()){
+		used -= it->second.numBytes;
+		lru.erase(it->second.lruPos);
+		cache.erase(it);
+	}
+
+	evictUntilFits(numBytes);
+	lru.push_front(relativePath);
+	CachedPixels & c = cache[relativePath];
+	c.pixels = pixels;
+	c.numBytes = numBytes;
+	c.lruPos = lru.begin();
+	used += numBytes;
+}
+
+
+void AssetImagePreloader::evictUntilFits(size_t numBytes){
+	while(used + numBytes > budget && lru.size()){
+		auto it = cache.find(lru.back());
+		if(it != cache.end()){
+			used -= it->second.numBytes;
+			cache.erase(it);
+		}
+		lru.pop_back();
+	}
+}
+
+
+void AssetImagePreloader::DecodeThread::threadedFunction(){
+
+	#ifdef TARGET_WIN32
+	#elif defined(TARGET_LINUX)
+	pthread_setname_np(pthread_self(), "AssetPreloader");
+	#else
+	pthread_setname_np("AssetPreloader");
+	#endif
+
+	Job job;
+	while(preloader->waitForJob(job)){
+		preloader->decode(job);
+	}
+}
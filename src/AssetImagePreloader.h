@@ -0,0 +1,103 @@
+//
+//  AssetImagePreloader.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include <queue>
+#include <list>
+#include <unordered_set>
+
+class AssetHolder;
+
+//decodes ready-to-use IMAGE assets into ofPixels on worker threads, so the render thread never
+//has to. Feed it AssetHolders (or let AssetChecker do it as it checks them, see
+//AssetChecker::setImagePreloader()), and poll tryGetPixels() from the main thread. Decoded
+//pixels are kept in an LRU cache that wont grow beyond the supplied memory budget.
+//Uploading to the GPU is up to you.
+
+class AssetImagePreloader{
+
+public:
+
+	AssetImagePreloader(){};
+	~AssetImagePreloader();
+
+	void setup(int numThreads = 2, size_t memoryBudget = 256 * 1024 * 1024);
+	void stop(); //waits for current decodes to end, drops pending ones
+
+	//higher priority gets decoded first. An asset gets the highest of its holder's priority
+	//and the priorities of all its tags. Set these before adding holders.
+	void setTagPriority(const string & tag, int priority);
+	void setHolderPriority(AssetHolder * holder, int priority);
+
+	void addHolder(AssetHolder * holder); //queue all its ready-to-use IMAGE assets. Thread safe. Ignored after stop().
+
+	//Bytes kept by AssetHolder::setRetainVerifiedBytes() are decoded from memory, and left there for
+	//you. If you only retain them for the preloader, let it release each one once decoded.
+	void setReleaseVerifiedBytes(bool release){releaseVerifiedBytes = release;}
+
+	//never blocks on a decode; nullptr if that asset is not decoded (yet)
+	std::shared_ptr<const ofPixels> tryGetPixels(const string & relativePath);
+
+	void evict(const string & relativePath);
+	void clear(); //drops all decoded pixels and pending decodes
+
+	size_t getMemoryUsed();
+	size_t getMemoryBudget(){return budget;}
+	int getNumPending();
+
+protected:
+
+	struct Job{
+		string relativePath;
+		string packFile; //if the image is an entry of an AssetPack
+		string packEntry;
+		int priority;
+		uint64_t order; //FIFO within same priority
+		bool operator<(const Job & o) const{
+			if(priority != o.priority) return priority < o.priority;
+			return order > o.order;
+		}
+	};
+
+	struct CachedPixels{
+		std::shared_ptr<const ofPixels> pixels;
+		size_t numBytes;
+		std::list<string>::iterator lruPos;
+	};
+
+	class DecodeThread : public ofThread{
+	public:
+		AssetImagePreloader * preloader = nullptr;
+	protected:
+		void threadedFunction();
+	};
+
+	bool waitForJob(Job & job); //false when stopping
+	void decode(const Job & job);
+	void storePixels(const string & relativePath, std::shared_ptr<ofPixels> pixels);
+	void evictUntilFits(size_t numBytes); //call with mutex locked!
+
+	vector<std::unique_ptr<DecodeThread>> threads;
+	bool stopping = false;
+	std::atomic<bool> releaseVerifiedBytes{false};
+
+	std::priority_queue<Job> jobs;
+	std::unordered_set<string> queuedOrDecoding;
+	uint64_t jobCounter = 0;
+
+	std::unordered_map<string, CachedPixels> cache;
+	std::list<string> lru; //most recently used first
+	size_t budget = 0;
+	size_t used = 0;
+
+	std::map<string, int> tagPriorities;
+	std::map<AssetHolder*, int> holderPriorities;
+
+	ofMutex mutex;
+	std::condition_variable jobAvailable;
+};
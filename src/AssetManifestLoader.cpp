@@ -0,0 +1,267 @@
+//
+//  AssetManifestLoader.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetManifestLoader.h"
+#include "AssetHolder.h"
+#include "AssetChecker.h"
+#include "AssetAsyncCheck.h"
+
+//receives the tokens from ofJson::sax_parse() and only keeps the asset entry being read.
+//std::string spelled out in here, string() is one of the handler methods
+struct AssetManifestSax{
+
+	AssetManifestLoader * loader;
+	int depth = 0;
+	int assetsDepth = -1; //depth of the assets array, -1 when not in it
+	bool topIsObject = false;
+	bool inEntry = false;
+	bool inTags = false;
+	std::string currentKey;
+	AssetManifestLoader::Entry entry;
+	std::string error;
+
+	bool atEntryLevel(){ return inEntry && depth == assetsDepth + 1; }
+
+	bool null(){ return true; }
+	bool boolean(bool){ return true; }
+	bool number_integer(ofJson::number_integer_t v){ return number((int64_t)v); }
+	bool number_unsigned(ofJson::number_unsigned_t v){ return number((int64_t)v); }
+	bool number_float(ofJson::number_float_t v, const std::string &){ return number((int64_t)v); }
+	template<class Binary> bool binary(Binary &){ return true; }
+
+	bool number(int64_t v){
+		if(atEntryLevel()){
+			if(currentKey == "width") entry.specs.width = v;
+			else if(currentKey == "height") entry.specs.height = v;
+		}
+		return true;
+	}
+
+	bool string(std::string & s){
+		if(inTags && depth == assetsDepth + 2){
+			entry.tags.push_back(s);
+		}else if(atEntryLevel()){
+			if(currentKey == "url") entry.url = s;
+			else if(currentKey == "checksum") entry.checksum = s;
+			else if(currentKey == "checksumType") entry.checksumType = s;
+			else if(currentKey == "type") entry.type = s;
+			else if(currentKey == "path") entry.path = s;
+			else if(currentKey == "pack") entry.pack = s;
+			else if(currentKey == "codec") entry.specs.codec = s;
+		}else if(topIsObject && depth == 1 && currentKey == "directory"){
+			loader->setDefaultDirectory(s);
+		}
+		return true;
+	}
+
+	bool key(std::string & k){
+		currentKey = k;
+		return true;
+	}
+
+	bool start_object(std::size_t){
+		depth++;
+		if(depth == 1) topIsObject = true;
+		if(assetsDepth > 0 && depth == assetsDepth + 1){
+			inEntry = true;
+			entry = AssetManifestLoader::Entry();
+		}
+		return true;
+	}
+
+	bool end_object(){
+		if(atEntryLevel()){
+			if(!loader->addEntry(entry, error)) return false; //stops the parse
+			inEntry = false;
+		}
+		depth--;
+		return true;
+	}
+
+	bool start_array(std::size_t){
+		depth++;
+		if(assetsDepth < 0 && ((depth == 1) || (topIsObject && depth == 2 && currentKey == "assets"))){
+			assetsDepth = depth;
+		}else if(inEntry && depth == assetsDepth + 2 && currentKey == "tags"){
+			inTags = true;
+		}
+		return true;
+	}
+
+	bool end_array(){
+		if(inTags && depth == assetsDepth + 2) inTags = false;
+		if(depth == assetsDepth) assetsDepth = -1;
+		depth--;
+		return true;
+	}
+
+	bool parse_error(std::size_t position, const std::string &, const std::exception & e){
+		error = std::string("at byte ") + ofToString(position) + ": " + e.what();
+		return false;
+	}
+};
+
+
+void AssetManifestLoader::setup(const string & defaultDirectory_, const ofxAssets::UsagePolicy & usagePolicy_,
+								const ofxAssets::DownloadPolicy & downloadPolicy_, int assetsPerHolder_){
+	defaultDirectory = defaultDirectory_;
+	usagePolicy = usagePolicy_;
+	downloadPolicy = downloadPolicy_;
+	assetsPerHolder = std::max(1, assetsPerHolder_);
+}
+
+
+bool AssetManifestLoader::load(const string & manifestPath, std::function<void(AssetHolder*)> onHolderReady_){
+
+	onHolderReady = onHolderReady_;
+	openHolders.clear();
+	numAssets = numBadEntries = 0;
+	error.clear();
+
+	std::ifstream file(ofToDataPath(manifestPath, true), std::ios::in | std::ios::binary);
+	if(!file.is_open()){
+		error = "can't open \"" + manifestPath + "\"";
+		ofLogError("AssetManifestLoader") << error;
+		return false;
+	}
+
+	AssetManifestSax sax;
+	sax.loader = this;
+	bool ok = false;
+	try{
+		ok = ofJson::sax_parse(file, &sax);
+	}catch(std::exception & e){
+		sax.error = e.what();
+	}
+	if(!ok){
+		error = "can't parse \"" + manifestPath + "\" " + sax.error;
+		ofLogError("AssetManifestLoader") << error;
+	}
+
+	//hand out the ones we didn't fill up, even if the parse failed halfway
+	for(auto & it : openHolders){
+		onHolderReady(it.second);
+	}
+	openHolders.clear();
+	onHolderReady = nullptr;
+	return ok;
+}
+
+
+std::shared_ptr<AssetAsyncCheck> AssetManifestLoader::loadAndCheck(const string & manifestPath,
+																   AssetChecker & checker,
+																   vector<AssetHolder*> & holders,
+																   int numThreads, int maxHoldersQueued){
+
+	//one set of check threads for the whole manifest, fed as we go
+	std::shared_ptr<AssetAsyncCheck> check = checker.checkAsyncFeed(std::max(1, numThreads));
+	size_t maxQueued = std::max(1, maxHoldersQueued);
+
+	//outlives this call, the continuation stays with the check
+	struct Backlog{
+		std::mutex mutex;
+		std::condition_variable holderDone;
+	};
+	auto backlog = std::make_shared<Backlog>();
+	check->then([backlog](AssetHolder *, bool){
+		{ std::unique_lock<std::mutex> lock(backlog->mutex); }
+		backlog->holderDone.notify_all();
+	});
+
+	load(manifestPath, [&](AssetHolder * h){
+		holders.push_back(h);
+		{ //don't parse too far ahead of the checker
+			std::unique_lock<std::mutex> lock(backlog->mutex);
+			backlog->holderDone.wait(lock, [&]{ return check->getNumPending() < maxQueued; });
+		}
+		check->add(vector<AssetHolder*>{h});
+	});
+	check->close();
+	return check;
+}
+
+
+bool AssetManifestLoader::addEntry(const Entry & e, string & parseError){
+
+	ofxAssets::Type type = typeFromString(e.type);
+	AssetHolder * h = nullptr;
+	int numBefore = 0;
+	if(e.url.size()){
+		//a checksum type we don't know would make every asset look corrupt (and get downloaded again)
+		ofxChecksum::Type checksumType;
+		if(!checksumTypeFromString(e.checksumType, e.checksum, checksumType)){
+			parseError = "unknown checksumType \"" + e.checksumType + "\" for \"" + e.url + "\"";
+			return false;
+		}
+		string dir = e.path.size() ? ofFilePath::getEnclosingDirectory(e.path, false) : defaultDirectory;
+		h = holderFor(dir);
+		numBefore = h->getNumAssets();
+		h->addRemoteAsset(e.url, e.checksum, checksumType, e.tags, e.specs, type);
+	}else if(e.pack.size() && e.path.size()){
+		h = holderFor(ofFilePath::getEnclosingDirectory(e.pack, false));
+		numBefore = h->getNumAssets();
+		h->addPackedAsset(e.pack, e.path, e.tags, e.specs, type);
+	}else if(e.path.size()){
+		h = holderFor(ofFilePath::getEnclosingDirectory(e.path, false));
+		numBefore = h->getNumAssets();
+		h->addLocalAsset(e.path, e.tags, e.specs, type);
+	}else{
+		ofLogError("AssetManifestLoader") << "Skipping manifest entry without \"url\" or \"path\"!";
+		numBadEntries++;
+		return true;
+	}
+	if(h->getNumAssets() > numBefore){
+		numAssets++;
+	}else{ //the holder said why (ie a duplicate)
+		numBadEntries++;
+	}
+	return true;
+}
+
+
+AssetHolder * AssetManifestLoader::holderFor(const string & directory){
+
+	AssetHolder * h = openHolders[directory];
+	if(h && h->getNumAssets() >= assetsPerHolder){ //full, off it goes
+		onHolderReady(h);
+		h = nullptr;
+	}
+	if(!h){
+		h = holderFactory ? holderFactory() : new AssetHolder();
+		h->setup(directory, usagePolicy, downloadPolicy);
+		openHolders[directory] = h;
+	}
+	return h;
+}
+
+
+ofxAssets::Type AssetManifestLoader::typeFromString(const string & t){
+	static const map<string, ofxAssets::Type> types = {
+		{"video", ofxAssets::VIDEO}, {"audio", ofxAssets::AUDIO}, {"image", ofxAssets::IMAGE},
+		{"json", ofxAssets::JSON}, {"text", ofxAssets::TEXT}, {"font", ofxAssets::FONT},
+		{"other", ofxAssets::OTHER}
+	};
+	auto it = types.find(ofToLower(t));
+	return it != types.end() ? it->second : ofxAssets::TYPE_UNKNOWN;
+}
+
+
+bool AssetManifestLoader::checksumTypeFromString(const string & t, const string & checksum, ofxChecksum::Type & type){
+	string lower = ofToLower(ofTrim(t));
+	if(lower.empty()){ //not given, guess from length
+		type = checksum.size() == 40 ? ofxChecksum::Type::SHA1 : ofxChecksum::Type::XX_HASH;
+		return true;
+	}
+	if(lower == "sha1"){
+		type = ofxChecksum::Type::SHA1;
+		return true;
+	}
+	if(lower == "xxhash" || lower == "xxhash64" || lower == "xxh64"){
+		type = ofxChecksum::Type::XX_HASH;
+		return true;
+	}
+	return false;
+}
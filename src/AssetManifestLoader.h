@@ -0,0 +1,99 @@
+//
+//  AssetManifestLoader.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "AssetHolderStructs.h"
+
+class AssetHolder;
+class AssetChecker;
+class AssetAsyncCheck;
+
+//Builds AssetHolders from a (potentially huge) JSON manifest without loading it into an ofJson DOM:
+//the file is parsed as a token stream (SAX) and each asset goes straight into an AssetHolder.
+//Every time a holder is full (assetsPerHolder) it's handed out, so you can start checking it
+//while the rest of the file is still being parsed (see loadAndCheck()).
+//
+//manifest format:
+//{
+//	"directory" : "downloads", //optional, where remote assets go. Must come before "assets"!
+//	"assets" : [
+//		{"url" : "http://host/a.jpg", "checksum" : "...", "checksumType" : "sha1", "type" : "image",
+//		 "tags" : ["big"], "width" : 1920, "height" : 1080, "codec" : ""},
+//		{"path" : "fonts/font.ttf"}, //local asset, relative to data
+//		{"pack" : "packs/thumbs.pak", "path" : "thumb1.jpg"}, //entry of an AssetPack
+//		...
+//	]
+//}
+//a plain array of assets works too. "path" on a remote asset only picks its directory.
+//Unknown keys are skipped.
+
+class AssetManifestLoader{
+
+public:
+
+	struct Entry{
+		string url;
+		string checksum;
+		string checksumType; //"sha1", "xxhash"; guessed from the checksum length if absent. Anything else is a parse error
+		string type; //"image", "video", etc; guessed from the file extension if empty
+		string path;
+		string pack; //if set, path is the name of an entry in this AssetPack
+		vector<string> tags;
+		ofxAssets::Specs specs;
+	};
+
+	void setup(const string & defaultDirectory,
+			   const ofxAssets::UsagePolicy & usagePolicy = ofxAssets::UsagePolicy(),
+			   const ofxAssets::DownloadPolicy & downloadPolicy = ofxAssets::DownloadPolicy(),
+			   int assetsPerHolder = 32);
+
+	//if you use your own AssetHolder subclass; defaults to new AssetHolder()
+	void setHolderFactory(std::function<AssetHolder*()> factory){holderFactory = factory;}
+
+	//blocking. Hands out each AssetHolder (already setup) as soon as it's full, and the ones
+	//left half full at the end. Called on this thread; you own the AssetHolders.
+	bool load(const string & manifestPath, std::function<void(AssetHolder*)> onHolderReady);
+
+	//load(), feeding each holder to one checker.checkAsyncFeed() as soon as it's ready, so it's
+	//checked while the rest of the manifest is parsed. Parsing waits while maxHoldersQueued holders
+	//are waiting to be checked. All holders end up in "holders" (you own them); wait on the returned
+	//check before using them.
+	std::shared_ptr<AssetAsyncCheck> loadAndCheck(const string & manifestPath,
+												  AssetChecker & checker,
+												  vector<AssetHolder*> & holders,
+												  int numThreads = std::thread::hardware_concurrency(),
+												  int maxHoldersQueued = 64);
+
+	size_t getNumAssets(){return numAssets;}
+	size_t getNumBadEntries(){return numBadEntries;}
+	const string & getError(){return error;}
+
+	static ofxAssets::Type typeFromString(const string & type); //TYPE_UNKNOWN if we dont know it
+	//false if we don't know the type; an empty type is guessed from the checksum length
+	static bool checksumTypeFromString(const string & type, const string & checksum, ofxChecksum::Type & result);
+
+protected:
+
+	friend struct AssetManifestSax;
+
+	void setDefaultDirectory(const string & dir){defaultDirectory = dir;}
+	bool addEntry(const Entry & e, string & parseError); //false stops the parse
+	AssetHolder * holderFor(const string & directory);
+
+	string defaultDirectory = "downloads";
+	ofxAssets::UsagePolicy usagePolicy;
+	ofxAssets::DownloadPolicy downloadPolicy;
+	int assetsPerHolder = 32;
+	std::function<AssetHolder*()> holderFactory;
+
+	std::function<void(AssetHolder*)> onHolderReady;
+	map<string, AssetHolder*> openHolders; //by directory, the ones being filled
+	size_t numAssets = 0;
+	size_t numBadEntries = 0;
+	string error;
+};
@@ -0,0 +1,416 @@
+//
+//  AssetPack.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetPack.h"
+#include "AssetHasher.h"
+
+#ifdef TARGET_WIN32
+	#include <windows.h>
+#else
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <cerrno>
+#endif
+
+std::unordered_map<string, std::shared_ptr<AssetPack>> AssetPack::openPacks;
+std::mutex AssetPack::packsMutex;
+
+static const char packMagic[8] = {'O', 'F', 'X', 'A', 'P', 'A', 'K', '1'};
+static const uint64_t packHeaderSize = sizeof(packMagic) + 3 * sizeof(uint64_t);
+static const uint64_t packAlignment = 8;
+
+
+bool AssetPack::build(const string & packPath, const vector<std::pair<string, string>> & files,
+					  ofxChecksum::Type checksumType, string & error){
+
+	string finalPath = ofToDataPath(packPath, true);
+	string tmpPath = finalPath + ".building";
+	ofDirectory::createDirectory(ofFilePath::getEnclosingDirectory(finalPath, false), false, true);
+	std::ofstream out(tmpPath, std::ios::out | std::ios::binary | std::ios::trunc);
+	if(!out.is_open()){
+		error = "can't write to \"" + tmpPath + "\"";
+		return false;
+	}
+
+	auto u64 = [&out](uint64_t v){ out.write((const char*)&v, sizeof(v)); };
+	auto str = [&out, &u64](const string & s){ u64(s.size()); out.write(s.data(), s.size()); };
+
+	//header is written again at the end, once we know where the index is
+	out.write(packMagic, sizeof(packMagic));
+	u64((uint64_t)checksumType); u64(files.size()); u64(0);
+
+	vector<Entry> written;
+	std::unordered_map<string, bool> names;
+	vector<char> block(1024 * 1024);
+	uint64_t offset = packHeaderSize;
+
+	for(auto & f : files){
+		if(names.count(f.first)){
+			error = "duplicate entry \"" + f.first + "\"";
+			break;
+		}
+		names[f.first] = true;
+
+		std::ifstream in(ofToDataPath(f.second, true), std::ios::in | std::ios::binary);
+		if(!in.is_open()){
+			error = "can't open \"" + f.second + "\"";
+			break;
+		}
+		Entry e;
+		e.name = f.first;
+		e.offset = offset;
+		ofxAssets::Hasher hasher(checksumType);
+		while(in){
+			in.read(block.data(), block.size());
+			std::streamsize n = in.gcount();
+			if(n <= 0) break;
+			hasher.update(block.data(), (size_t)n);
+			out.write(block.data(), n);
+		}
+		if(in.bad()){
+			error = "read error on \"" + f.second + "\"";
+			break;
+		}
+		e.size = hasher.getNumBytesHashed();
+		e.checksum = hasher.getHexDigest();
+		offset += e.size;
+		uint64_t pad = (packAlignment - offset % packAlignment) % packAlignment;
+		static const char zeros[packAlignment] = {0};
+		out.write(zeros, pad);
+		offset += pad;
+		written.push_back(e);
+	}
+
+	if(error.empty()){
+		for(auto & e : written){
+			str(e.name); u64(e.offset); u64(e.size); str(e.checksum);
+		}
+		out.seekp(sizeof(packMagic) + 2 * sizeof(uint64_t));
+		u64(offset);
+	}
+	out.close();
+	if(error.empty() && !out){
+		error = "write error on \"" + tmpPath + "\"";
+	}
+
+	if(error.empty()){
+		try{
+			std::filesystem::rename(tmpPath, finalPath); //atomic, replaces the old pack if any
+		}catch(std::exception & e){
+			error = string("can't move pack into place: ") + e.what();
+		}
+	}
+	if(error.size()){
+		ofFile::removeFile(tmpPath, false);
+		ofLogError("AssetPack") << "Can't build \"" << packPath << "\": " << error;
+		return false;
+	}
+	return true;
+}
+
+
+std::shared_ptr<AssetPack> AssetPack::get(const string & packPath){
+
+	string absPath = ofToDataPath(packPath, true);
+	std::unique_lock<std::mutex> lock(packsMutex);
+
+	auto it = openPacks.find(absPath);
+	if(it != openPacks.end()){
+		std::error_code err;
+		auto modified = std::filesystem::last_write_time(absPath, err);
+		if(!err && modified == it->second->modified){
+			return it->second;
+		}
+		openPacks.erase(it); //whoever holds the old one keeps its mapping until they let go
+	}
+
+	auto pack = std::make_shared<AssetPack>();
+	if(!pack->open(packPath)){
+		return nullptr;
+	}
+	openPacks[absPath] = pack;
+	return pack;
+}
+
+
+AssetPack::~AssetPack(){
+	close();
+}
+
+
+bool AssetPack::open(const string & packPath){
+
+	close();
+	path = packPath;
+	string absPath = ofToDataPath(packPath, true);
+	std::error_code err;
+	modified = std::filesystem::last_write_time(absPath, err);
+	if(err){
+		ofLogError("AssetPack") << "Can't open \"" << packPath << "\": " << err.message();
+		return false;
+	}
+	if(!mapFile(absPath)){
+		return false;
+	}
+	if(!readIndex()){
+		ofLogError("AssetPack") << "\"" << packPath << "\" is not a valid pack!";
+		close();
+		return false;
+	}
+	return true;
+}
+
+
+bool AssetPack::mapFile(const string & absPath){
+
+	#ifdef TARGET_WIN32
+	HANDLE file = CreateFileA(absPath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if(file == INVALID_HANDLE_VALUE){
+		ofLogError("AssetPack") << "Can't open \"" << absPath << "\"";
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	const char * view = mapping ? (const char *)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+	if(!view){
+		ofLogError("AssetPack") << "Can't map \"" << absPath << "\"";
+		if(mapping) CloseHandle(mapping);
+		CloseHandle(file);
+		return false;
+	}
+	fileHandle = file;
+	mappingHandle = mapping;
+	mapped = view;
+	mappedSize = size.QuadPart;
+	#else
+	int fd = ::open(absPath.c_str(), O_RDONLY);
+	if(fd < 0){
+		ofLogError("AssetPack") << "Can't open \"" << absPath << "\"";
+		return false;
+	}
+	struct stat st;
+	void * view = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && st.st_size > 0){
+		view = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	if(view == MAP_FAILED){
+		::close(fd);
+		ofLogError("AssetPack") << "Can't map \"" << absPath << "\"";
+		return false;
+	}
+	this->fd = fd;
+	mapped = (const char *)view;
+	mappedSize = st.st_size;
+	#endif
+	return true;
+}
+
+
+bool AssetPack::readIndex(){
+
+	if(mappedSize < packHeaderSize || memcmp(mapped, packMagic, sizeof(packMagic)) != 0){
+		return false;
+	}
+
+	uint64_t pos = sizeof(packMagic);
+	bool ok = true;
+	auto u64 = [&]() -> uint64_t{
+		uint64_t v = 0;
+		if(pos + sizeof(v) > mappedSize){ ok = false; return 0; }
+		memcpy(&v, mapped + pos, sizeof(v));
+		pos += sizeof(v);
+		return v;
+	};
+	auto str = [&]() -> string{
+		uint64_t len = u64();
+		if(!ok || len > mappedSize - pos){ ok = false; return string(); }
+		string s(mapped + pos, len);
+		pos += len;
+		return s;
+	};
+
+	checksumType = (ofxChecksum::Type)u64();
+	uint64_t numEntries = u64();
+	uint64_t indexOffset = u64();
+	if(!ok || indexOffset < packHeaderSize || indexOffset > mappedSize) return false;
+
+	pos = indexOffset;
+	entries.clear();
+	index.clear();
+	for(uint64_t i = 0; i < numEntries && ok; i++){
+		Entry e;
+		e.name = str(); e.offset = u64(); e.size = u64(); e.checksum = str();
+		if(!ok || e.offset < packHeaderSize || e.offset > indexOffset || e.size > indexOffset - e.offset){
+			return false; //points outside the data
+		}
+		index[e.name] = entries.size();
+		entries.push_back(e);
+	}
+	entryOK.assign(entries.size(), false);
+	verified = false;
+	return ok;
+}
+
+
+void AssetPack::close(){
+
+	if(!mapped) return;
+	#ifdef TARGET_WIN32
+	UnmapViewOfFile(mapped);
+	CloseHandle((HANDLE)mappingHandle);
+	CloseHandle((HANDLE)fileHandle);
+	mappingHandle = fileHandle = nullptr;
+	#else
+	munmap((void *)mapped, mappedSize);
+	::close(fd);
+	fd = -1;
+	#endif
+	mapped = nullptr;
+	mappedSize = 0;
+	entries.clear();
+	index.clear();
+	entryOK.clear();
+	verified = false;
+}
+
+
+const AssetPack::Entry * AssetPack::getEntry(const string & name) const{
+	auto it = index.find(name);
+	if(it == index.end()) return nullptr;
+	return &entries[it->second];
+}
+
+
+bool AssetPack::isIntact() const{
+	if(!mapped) return false;
+	#ifdef TARGET_WIN32
+	return true;
+	#else
+	struct stat st;
+	return fstat(fd, &st) == 0 && (uint64_t)st.st_size >= mappedSize;
+	#endif
+}
+
+
+bool AssetPack::read(uint64_t offset, char * dst, size_t len) const{
+	if(!mapped || offset + len > mappedSize) return false;
+	#ifdef TARGET_WIN32
+	memcpy(dst, mapped + offset, len); //the file can't be truncated while we have it mapped
+	return true;
+	#else
+	while(len > 0){
+		ssize_t n = pread(fd, dst, len, (off_t)offset);
+		if(n < 0 && errno == EINTR) continue;
+		if(n <= 0) return false; //error, or the end of a file that shrunk
+		dst += n;
+		offset += n;
+		len -= n;
+	}
+	return true;
+	#endif
+}
+
+
+AssetPack::Slice AssetPack::getSlice(const string & name) const{
+	Slice s;
+	const Entry * e = getEntry(name);
+	if(e && mapped){
+		if(!isIntact()){
+			ofLogError("AssetPack") << "\"" << path << "\" was truncated on disk! can't read \"" << name << "\"";
+			return s;
+		}
+		s.data = mapped + e->offset;
+		s.size = e->size;
+		s.pack = weak_from_this().lock(); //null if this pack is not owned by a shared_ptr
+	}
+	return s;
+}
+
+
+void AssetPack::verify(ofxAssets::CheckCounters * counters){
+	std::unique_lock<std::mutex> lock(verifyMutex);
+	verifyLocked(counters);
+}
+
+
+void AssetPack::invalidate(){
+	std::unique_lock<std::mutex> lock(verifyMutex);
+	verified = false;
+}
+
+
+bool AssetPack::verifyEntry(const string & name, ofxAssets::CheckCounters * counters){
+	std::unique_lock<std::mutex> lock(verifyMutex); //so an invalidate() can't get in between
+	verifyLocked(counters);
+	auto it = index.find(name);
+	return it != index.end() && entryOK[it->second];
+}
+
+
+void AssetPack::verifyLocked(ofxAssets::CheckCounters * counters){
+
+	if(verified || !mapped) return;
+
+	//in file order, so the disk sees one sequential read
+	vector<size_t> order(entries.size());
+	for(size_t i = 0; i < order.size(); i++) order[i] = i;
+	std::sort(order.begin(), order.end(), [this](size_t a, size_t b){ return entries[a].offset < entries[b].offset; });
+
+	#if defined(TARGET_LINUX)
+	posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+	#endif
+
+	//read(), not the mapping: a truncated file is a short read here, not a SIGBUS
+	const uint64_t step = 1024 * 1024; //to update the counters as we go on big entries
+	vector<char> block(step);
+	bool intact = true;
+	for(auto i : order){
+		const Entry & e = entries[i];
+		ofxAssets::Hasher hasher(checksumType);
+		for(uint64_t done = 0; done < e.size && intact; done += step){
+			size_t n = (size_t)std::min(step, e.size - done);
+			intact = read(e.offset + done, block.data(), n);
+			if(!intact) break;
+			hasher.update(block.data(), n);
+			if(counters) counters->numBytes += n;
+		}
+		if(!intact){ //this one and all the ones we didn't get to
+			entryOK[i] = false;
+			continue;
+		}
+		entryOK[i] = hasher.matches(e.checksum);
+		if(!entryOK[i]){
+			ofLogError("AssetPack") << "\"" << path << "\" entry \"" << e.name << "\" is CORRUPT!";
+		}
+	}
+
+	if(!intact){
+		ofLogError("AssetPack") << "\"" << path << "\" can't be read (truncated on disk?) while verifying!";
+	}
+
+	#if defined(TARGET_LINUX)
+	posix_fadvise(fd, 0, 0, POSIX_FADV_NORMAL);
+	#endif
+	verified = true;
+}
+
+
+bool AssetPack::isEntryOK(const string & name){
+	std::unique_lock<std::mutex> lock(verifyMutex);
+	if(!verified) return false;
+	auto it = index.find(name);
+	return it != index.end() && entryOK[it->second];
+}
+
+
+size_t AssetPack::getNumCorruptEntries(){
+	std::unique_lock<std::mutex> lock(verifyMutex);
+	if(!verified) return 0;
+	return std::count(entryOK.begin(), entryOK.end(), false);
+}
@@ -0,0 +1,112 @@
+//
+//  AssetPack.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxChecksum.h"
+#include "AssetHolderStructs.h"
+
+//A pack file concatenates many small assets (thumbnails, json, etc) into one file, so checking and
+//loading them doesn't pay the open / stat / hash overhead once per file. Layout:
+//
+//	header: "OFXAPAK1", checksumType, numEntries, indexOffset (u64s)
+//	data: the entries back to back, each 8 byte aligned
+//	index (at indexOffset): for each entry, name, offset, size and checksum
+//
+//The whole file is memory mapped, and entries are handed out as Slices that point straight into the
+//mapping (no copies). verify() hashes all entries in one sequential pass with plain reads instead, so
+//a pack truncated under us is a read error there rather than a SIGBUS.
+//AssetHolder::addPackedAsset() adds a pack entry as an asset.
+
+class AssetPack : public std::enable_shared_from_this<AssetPack>{
+
+public:
+
+	struct Entry{
+		string name; //unique within the pack
+		uint64_t offset = 0; //from the start of the pack file
+		uint64_t size = 0;
+		string checksum;
+	};
+
+	struct Slice{ //an entry's bytes inside the mapping; keeps the pack mapped while you hold it
+		const char * data = nullptr;
+		size_t size = 0;
+		std::shared_ptr<const AssetPack> pack; //null if the pack didn't come from AssetPack::get()
+		bool isValid() const {return data != nullptr;}
+	};
+
+	//writes a new pack with these files (entry name, file path relative to data), hashing them as
+	//they are copied in. Returns false (and why in error) if any of them can't be read.
+	static bool build(const string & packPath, const vector<std::pair<string, string>> & files,
+					  ofxChecksum::Type checksumType, string & error);
+
+	//one shared, open instance per pack file (relative to data); reopened if the file changed
+	//on disk. nullptr if it can't be opened.
+	static std::shared_ptr<AssetPack> get(const string & packPath);
+
+	~AssetPack();
+
+	bool open(const string & packPath); //maps the file and reads the index
+	void close();
+	bool isOpen() const {return mapped != nullptr;}
+
+	const string & getPath() const {return path;}
+	ofxChecksum::Type getChecksumType() const {return checksumType;}
+	const vector<Entry> & getEntries() const {return entries;}
+	const Entry * getEntry(const string & name) const; //nullptr if not in the pack
+
+	Slice getSlice(const string & name) const; //invalid if not in the pack, or if the file shrunk
+
+	//the file is still as big as when we mapped it. Reading a mapping past the end of a file that was
+	//truncated under us is a SIGBUS; getSlice() checks this first, which makes that less likely but
+	//can't rule it out (the file can shrink right after). If packs can change under you, use read().
+	bool isIntact() const;
+
+	//copies len bytes at offset (from the start of the file) into dst with a plain read, not through
+	//the mapping. False if they are not all there (ie the file was truncated) or on a read error.
+	bool read(uint64_t offset, char * dst, size_t len) const;
+
+	//hashes every entry in one sequential pass over the file, unless that was done already since the
+	//last invalidate() (concurrent callers wait for it). counters, if any, are updated as we go.
+	void verify(ofxAssets::CheckCounters * counters = nullptr);
+	void invalidate(); //so the next verify() hashes it all again; ie a new check pass
+	bool isVerified() const {return verified;}
+	bool isEntryOK(const string & name); //false until verify()
+	bool verifyEntry(const string & name, ofxAssets::CheckCounters * counters = nullptr); //verify() if needed, then isEntryOK()
+	size_t getNumCorruptEntries();
+
+protected:
+
+	string path;
+	ofxChecksum::Type checksumType = ofxChecksum::Type::XX_HASH;
+	vector<Entry> entries;
+	std::unordered_map<string, size_t> index;
+
+	//mapping
+	const char * mapped = nullptr;
+	uint64_t mappedSize = 0;
+	#ifdef TARGET_WIN32
+	void * fileHandle = nullptr; //windows won't let anyone truncate it while it's mapped
+	void * mappingHandle = nullptr;
+	#else
+	int fd = -1; //kept open for read() and isIntact()
+	#endif
+	std::filesystem::file_time_type modified; //to notice the file changed under us
+
+	//verification
+	std::atomic<bool> verified{false};
+	vector<bool> entryOK;
+	std::mutex verifyMutex;
+
+	bool mapFile(const string & absPath);
+	bool readIndex();
+	void verifyLocked(ofxAssets::CheckCounters * counters); //call with verifyMutex locked
+
+	static std::unordered_map<string, std::shared_ptr<AssetPack>> openPacks;
+	static std::mutex packsMutex;
+};
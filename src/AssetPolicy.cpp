@@ -0,0 +1,103 @@
+//
+//  AssetPolicy.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetPolicy.h"
+
+using namespace ofxAssets;
+
+
+CompiledPolicy CompiledPolicy::compile(const UsagePolicy & usage, const DownloadPolicy & download){
+
+	CompiledPolicy c;
+	for(uint32_t bits = 0; bits < NUM_STATUS_COMBINATIONS; bits++){
+		LocalAssetStatus s = LocalAssetStatus::unpack(bits);
+		if(referenceIsReadyToUse(usage, s)) c.readyMask |= 1u << bits;
+		if(referenceShouldDownload(download, s)) c.downloadMask |= 1u << bits;
+	}
+	return c;
+}
+
+
+static size_t countMaskHits(uint32_t mask, const uint8_t * packedStatus, size_t num){
+	size_t n = 0;
+	for(size_t i = 0; i < num; i++){ //no branches, compilers vectorize this
+		n += (mask >> (packedStatus[i] & (NUM_STATUS_COMBINATIONS - 1))) & 1u;
+	}
+	return n;
+}
+
+
+size_t CompiledPolicy::countReady(const uint8_t * packedStatus, size_t num) const{
+	return countMaskHits(readyMask, packedStatus, num);
+}
+
+
+size_t CompiledPolicy::countToDownload(const uint8_t * packedStatus, size_t num) const{
+	return countMaskHits(downloadMask, packedStatus, num);
+}
+
+
+bool CompiledPolicy::referenceShouldDownload(const DownloadPolicy & downloadPolicy, const LocalAssetStatus & status){
+
+	bool shouldDownload = false;
+	//lets see if we should download this asset
+	if(status.checked){
+		if(downloadPolicy.fileMissing && !status.localFileExists) return true;
+		if(downloadPolicy.fileExistsAndNoChecksumProvided && !status.checksumSupplied) return true;
+		if(downloadPolicy.fileExistsAndProvidedChecksumMissmatch && status.checksumSupplied && !status.checksumMatch) return true;
+		if(downloadPolicy.fileExistsAndProvidedChecksumMatch && status.checksumSupplied && !status.checksumMatch) return true;
+		if(!status.checksumMatch && status.checksumSupplied){ //if we have a sha1 match - file size is irrelevant so no more tests to run
+			if(downloadPolicy.fileTooSmall && status.fileTooSmall) return true;
+		}
+	}
+	return shouldDownload;
+}
+
+
+bool CompiledPolicy::referenceIsReadyToUse(const UsagePolicy & assetOkPolicy, const LocalAssetStatus & status){
+
+	bool isOKtoUse = false;
+
+	//lets see if we should use this asset
+	if(status.checked){
+
+		if(!status.checksumSupplied){ //no checksum is used
+
+			bool checksumOK = status.checksumMatch;
+			if(assetOkPolicy.fileExistsAndNoChecksumProvided) checksumOK = true;
+
+			bool fileSizeOK = !status.fileTooSmall;
+			if(assetOkPolicy.fileTooSmall) fileSizeOK = true;
+
+			bool fileExistsOK = status.localFileExists;
+			if(assetOkPolicy.fileMissing) fileExistsOK = true;
+
+			isOKtoUse = fileSizeOK && fileExistsOK && checksumOK;
+
+		}else{ //ckecksum is USED
+
+			bool useIf_exists = (status.localFileExists || assetOkPolicy.fileMissing);
+			bool useIf_sha1_exists = (assetOkPolicy.fileExistsAndNoChecksumProvided || status.checksumSupplied);
+
+			bool useIf_sha1;
+			if(assetOkPolicy.fileExistsAndProvidedChecksumMatch){
+				useIf_sha1 = status.checksumMatch;
+			}else{
+				useIf_sha1 = status.checksumMatch || assetOkPolicy.fileExistsAndProvidedChecksumMissmatch;
+			}
+
+			bool useIf_tooSmall;
+			if(!status.fileTooSmall){
+				useIf_tooSmall = true;
+			}else{ //too small!
+				useIf_tooSmall = assetOkPolicy.fileTooSmall;
+			}
+			isOKtoUse = useIf_tooSmall && useIf_sha1 && useIf_sha1_exists && useIf_exists;
+		}
+	}
+	return isOKtoUse;
+}
+
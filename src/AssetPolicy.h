@@ -0,0 +1,34 @@
+//
+//  AssetPolicy.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "AssetHolderStructs.h"
+
+namespace ofxAssets{
+
+	//a UsagePolicy + DownloadPolicy pair, evaluated once (at AssetHolder::setup()) for every possible
+	//packed LocalAssetStatus. Deciding for an asset is then a shift and a mask, no branches.
+	struct CompiledPolicy{
+
+		uint32_t readyMask = 0;		//bit N is set if an asset with packed status N is ready to use
+		uint32_t downloadMask = 0;	//bit N is set if an asset with packed status N should be downloaded
+
+		static CompiledPolicy compile(const UsagePolicy & usage, const DownloadPolicy & download);
+
+		bool isReadyToUse(uint8_t packedStatus) const{return (readyMask >> packedStatus) & 1u;}
+		bool shouldDownload(uint8_t packedStatus) const{return (downloadMask >> packedStatus) & 1u;}
+
+		//whole holder at once, over contiguous packed status bytes
+		size_t countReady(const uint8_t * packedStatus, size_t num) const;
+		size_t countToDownload(const uint8_t * packedStatus, size_t num) const;
+
+		//the original (branchy) policy interpretation; the masks are built from these.
+		//example-policyCheck tests both against a hand written truth table.
+		static bool referenceIsReadyToUse(const UsagePolicy & policy, const LocalAssetStatus & s);
+		static bool referenceShouldDownload(const DownloadPolicy & policy, const LocalAssetStatus & s);
+	};
+}
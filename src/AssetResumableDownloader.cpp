@@ -0,0 +1,300 @@
+//
+//  AssetResumableDownloader.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetResumableDownloader.h"
+#include "AssetHttpRange.h"
+
+using namespace ofxAssets;
+
+
+AssetResumableDownloader::~AssetResumableDownloader(){
+	canceled = true;
+	downloadMutex.lock();
+	stopping = true;
+	downloadMutex.unlock();
+	hasWork.notify_all();
+	waitForThread(false);
+}
+
+
+void AssetResumableDownloader::addBatch(const vector<string> & urls, const vector<string> & checksums,
+										const vector<ofxChecksum::Type> & checksumTypes,
+										std::function<void(ofxBatchDownloaderReport &)> callback,
+										const string & destinationFolder){
+
+	if(urls.size() != checksums.size() || urls.size() != checksumTypes.size()){
+		ofLogError("AssetResumableDownloader") << "urls, checksums and checksumTypes must be the same size!";
+		return;
+	}
+
+	Batch batch;
+	for(size_t i = 0; i < urls.size(); i++){
+		Job j;
+		j.url = urls[i];
+		j.checksum = checksums[i];
+		j.checksumType = checksumTypes[i];
+		batch.jobs.push_back(j);
+	}
+	batch.destinationFolder = ofFilePath::addTrailingSlash(destinationFolder);
+	batch.callback = callback;
+
+	downloadMutex.lock();
+	pending.push_back(batch);
+	numBatchesInFlight++;
+	canceled = false;
+	downloadMutex.unlock();
+	hasWork.notify_one();
+
+	if(!isThreadRunning()){
+		startThread();
+	}
+}
+
+
+void AssetResumableDownloader::update(){
+
+	std::deque<Batch> done;
+	downloadMutex.lock();
+	done.swap(finished);
+	downloadMutex.unlock();
+
+	for(auto & b : done){
+		b.callback(b.report);
+	}
+}
+
+
+bool AssetResumableDownloader::isBusy(){
+	std::unique_lock<std::mutex> lock(downloadMutex);
+	return numBatchesInFlight > 0;
+}
+
+
+void AssetResumableDownloader::cancelAllDownloads(){
+	downloadMutex.lock();
+	canceled = true;
+	//batches we didn't get to are reported as canceled too, so their listeners know they are over
+	for(auto & batch : pending){
+		batch.report.downloadPath = batch.destinationFolder;
+		batch.report.owner = this;
+		for(auto & job : batch.jobs){
+			addToReport(batch.report, job, canceledResponse(job));
+		}
+		batch.report.wasCanceled = true;
+		numBatchesInFlight--;
+		finished.push_back(batch);
+	}
+	pending.clear();
+	downloadMutex.unlock();
+}
+
+
+ofxSimpleHttpResponse AssetResumableDownloader::canceledResponse(const Job & job){
+	ofxSimpleHttpResponse r;
+	r.url = job.url;
+	r.ok = false;
+	r.reasonForStatus = "canceled";
+	r.checksumType = job.checksumType;
+	r.expectedChecksum = job.checksum;
+	r.checksumOK = false;
+	return r;
+}
+
+
+void AssetResumableDownloader::addToReport(ofxBatchDownloaderReport & report, const Job & job, const ofxSimpleHttpResponse & r){
+	report.attemptedDownloads.push_back(job.url);
+	if(r.ok){
+		report.successfulDownloads.push_back(job.url);
+	}else{
+		report.failedDownloads.push_back(job.url);
+	}
+	report.responses.push_back(r);
+}
+
+
+void AssetResumableDownloader::threadedFunction(){
+
+	#ifdef TARGET_WIN32
+	#elif defined(TARGET_LINUX)
+	pthread_setname_np(pthread_self(), "AssetDownloader");
+	#else
+	pthread_setname_np("AssetDownloader");
+	#endif
+
+	while(true){
+
+		Batch batch;
+		{
+			std::unique_lock<std::mutex> lock(downloadMutex);
+			hasWork.wait(lock, [this]{ return stopping || pending.size(); });
+			if(stopping) break;
+			batch = pending.front();
+			pending.pop_front();
+		}
+
+		batch.report.downloadPath = batch.destinationFolder;
+		batch.report.owner = this;
+		for(auto & job : batch.jobs){
+			addToReport(batch.report, job, canceled ? canceledResponse(job) : download(job, batch.destinationFolder));
+		}
+		batch.report.wasCanceled = canceled;
+
+		std::unique_lock<std::mutex> lock(downloadMutex);
+		numBatchesInFlight--;
+		finished.push_back(batch); //even if canceled, so the listener knows its batch is over
+	}
+}
+
+
+ofxSimpleHttpResponse AssetResumableDownloader::download(const Job & job, const string & destinationFolder){
+
+	ofxSimpleHttpResponse r;
+	r.url = job.url;
+	r.ok = false;
+	r.checksumOK = false;
+	r.checksumType = job.checksumType;
+	r.expectedChecksum = job.checksum;
+	r.downloadedBytes = 0;
+
+	//same file name AssetHolder::addRemoteAsset() expects
+	string finalPath = ofToDataPath(destinationFolder + ofFilePath::getFileName(job.url), true);
+	string partPath = getPartialFilePath(finalPath);
+	string statePath = getStateFilePath(finalPath);
+
+	Hasher hasher(job.checksumType);
+	uint64_t offset = 0;
+	if(loadState(statePath, partPath, job, offset, hasher)){
+		ofLogNotice("AssetResumableDownloader") << "Resuming \"" << job.url << "\" at byte " << offset;
+	}else{
+		hasher.reset();
+		offset = 0;
+	}
+
+	std::ofstream file(partPath, std::ios::out | std::ios::binary | (offset > 0 ? std::ios::app : std::ios::trunc));
+	if(!file.is_open()){
+		r.reasonForStatus = "can't write to \"" + partPath + "\"";
+		return r;
+	}
+
+	uint64_t written = offset;
+	uint64_t lastSave = offset;
+	uint64_t totalSize = 0;
+	bool rangeHonored = false;
+	bool firstData = true;
+	string error;
+
+	auto onData = [&](const char * data, size_t len) -> bool{
+		if(firstData){
+			firstData = false;
+			if(!rangeHonored && offset > 0){ //server sends the whole thing, start over
+				ofLogWarning("AssetResumableDownloader") << "Server ignored Range request, restarting \"" << job.url << "\"";
+				file.close();
+				file.open(partPath, std::ios::out | std::ios::binary | std::ios::trunc);
+				hasher.reset();
+				written = lastSave = offset = 0;
+			}
+		}
+		if(limiter) limiter->consume(len);
+		file.write(data, len);
+		if(!file) return false;
+		hasher.update(data, len);
+		written += len;
+		if(written - lastSave >= stateSaveInterval){
+			file.flush(); //bytes on disk before the state that claims them
+			saveState(statePath, job, written, hasher);
+			lastSave = written;
+		}
+		return !canceled;
+	};
+
+	//if the .part is complete already (ie we died before renaming it), the server replies 416 and
+	//we go straight to verifying it; if it turns out bad it's dropped, so we don't ask again forever
+	bool ok = HttpRange::fetchFrom(job.url, offset, onData, totalSize, rangeHonored, error, timeoutSeconds);
+	file.close();
+
+	if(!ok){ //keep what we got for next time
+		saveState(statePath, job, written, hasher);
+		r.reasonForStatus = error;
+		r.downloadedBytes = written;
+		return r;
+	}
+
+	r.downloadedBytes = written;
+	r.calculatedChecksum = hasher.getHexDigest();
+	bool checksumOK = job.checksum.empty() || hasher.matches(job.checksum);
+
+	if(totalSize > 0 && written != totalSize){
+		r.reasonForStatus = "got " + ofToString(written) + " bytes, expected " + ofToString(totalSize);
+		checksumOK = false;
+	}
+
+	if(!checksumOK){ //a complete but bad file is useless for resuming
+		ofFile::removeFile(partPath, false);
+		ofFile::removeFile(statePath, false);
+		if(r.reasonForStatus.empty()) r.reasonForStatus = "checksum mismatch";
+		return r;
+	}
+
+	try{
+		std::filesystem::rename(partPath, finalPath); //atomic, replaces the old file if any
+	}catch(std::exception & e){
+		r.reasonForStatus = string("can't move download into place: ") + e.what();
+		return r;
+	}
+	ofFile::removeFile(statePath, false);
+
+	r.ok = true;
+	r.checksumOK = true;
+	r.reasonForStatus = "OK";
+	return r;
+}
+
+
+bool AssetResumableDownloader::loadState(const string & statePath, const string & partPath, const Job & job,
+										 uint64_t & offset, Hasher & hasher){
+
+	if(!ofFile::doesFileExist(statePath, false) || !ofFile::doesFileExist(partPath, false)){
+		return false;
+	}
+
+	try{
+		ofJson state = ofLoadJson(statePath);
+		if(state["url"].get<string>() != job.url || state["checksum"].get<string>() != job.checksum){
+			return false; //sidecar for some other version of this file
+		}
+		offset = state["offset"].get<uint64_t>();
+		if(!hasher.setState(state["hashState"].get<string>()) || hasher.getNumBytesHashed() != offset){
+			return false;
+		}
+		if(std::filesystem::file_size(partPath) < offset){
+			return false;
+		}
+		std::filesystem::resize_file(partPath, offset); //drop whatever was written after the last save
+		return offset > 0;
+	}catch(std::exception & e){
+		ofLogWarning("AssetResumableDownloader") << "Ignoring bad resume state \"" << statePath << "\": " << e.what();
+	}
+	return false;
+}
+
+
+void AssetResumableDownloader::saveState(const string & statePath, const Job & job, uint64_t offset, const Hasher & hasher){
+
+	ofJson state;
+	state["url"] = job.url;
+	state["checksum"] = job.checksum;
+	state["offset"] = offset;
+	state["hashState"] = hasher.getState();
+
+	string tmpPath = statePath + ".tmp";
+	if(ofSavePrettyJson(tmpPath, state)){
+		try{
+			std::filesystem::rename(tmpPath, statePath);
+		}catch(std::exception & e){
+			ofLogError("AssetResumableDownloader") << "Can't save resume state \"" << statePath << "\": " << e.what();
+		}
+	}
+}
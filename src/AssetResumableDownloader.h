@@ -0,0 +1,101 @@
+//
+//  AssetResumableDownloader.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "ofxDownloadCentral.h"
+#include "AssetHasher.h"
+#include "AssetBandwidthLimiter.h"
+
+//Alternative to ofxDownloadCentral for AssetHolder::downloadMissingAssets() that survives restarts.
+//Each download is written to "<file>.part", next to a "<file>.part.json" sidecar holding the url,
+//the expected checksum, the number of bytes already on disk and the hashing state up to there.
+//If the process dies mid transfer, the next downloadMissingAssets() picks it up with an HTTP
+//Range request instead of starting from zero. Once complete, the checksum is verified (no
+//extra read, it's been hashed as it came in) and the file is renamed into place.
+//Like ofxDownloadCentral, call update() from the main thread; that's where you get notified.
+
+class AssetResumableDownloader : public ofThread{
+
+public:
+
+	~AssetResumableDownloader();
+
+	template <class ListenerClass>
+	void downloadResources(const vector<string> & urls,
+						   const vector<string> & checksums,
+						   const vector<ofxChecksum::Type> & checksumTypes,
+						   ListenerClass * listener,
+						   void (ListenerClass::*listenerMethod)(ofxBatchDownloaderReport &),
+						   const string & destinationFolder){
+		std::function<void(ofxBatchDownloaderReport &)> callback = [listener, listenerMethod](ofxBatchDownloaderReport & report){
+			(listener->*listenerMethod)(report);
+		};
+		addBatch(urls, checksums, checksumTypes, callback, destinationFolder);
+	}
+
+	//same, for when you need a lambda
+	void downloadResources(const vector<string> & urls,
+						   const vector<string> & checksums,
+						   const vector<ofxChecksum::Type> & checksumTypes,
+						   std::function<void(ofxBatchDownloaderReport &)> callback,
+						   const string & destinationFolder){
+		addBatch(urls, checksums, checksumTypes, callback, destinationFolder);
+	}
+
+	void update(); //delivers finished batches to their listeners
+	bool isBusy();
+	void cancelAllDownloads(); //in flight downloads keep their partial files, so they can be resumed later;
+							   //every batch not done yet is still reported (as canceled) from update()
+
+	void setTimeout(int seconds){timeoutSeconds = seconds;}
+	void setStateSaveInterval(uint64_t numBytes){stateSaveInterval = numBytes;} //how often we update the sidecar
+	void setBandwidthLimiter(ofxAssets::BandwidthLimiter * l){limiter = l;} //can be shared by several downloaders
+
+	static string getPartialFilePath(const string & absolutePath){return absolutePath + ".part";}
+	static string getStateFilePath(const string & absolutePath){return absolutePath + ".part.json";}
+
+protected:
+
+	struct Job{
+		string url;
+		string checksum;
+		ofxChecksum::Type checksumType;
+	};
+
+	struct Batch{
+		vector<Job> jobs;
+		string destinationFolder;
+		std::function<void(ofxBatchDownloaderReport &)> callback;
+		ofxBatchDownloaderReport report;
+	};
+
+	void addBatch(const vector<string> & urls, const vector<string> & checksums,
+				  const vector<ofxChecksum::Type> & checksumTypes,
+				  std::function<void(ofxBatchDownloaderReport &)> callback, const string & destinationFolder);
+
+	void threadedFunction();
+	ofxSimpleHttpResponse download(const Job & job, const string & destinationFolder);
+	static ofxSimpleHttpResponse canceledResponse(const Job & job);
+	static void addToReport(ofxBatchDownloaderReport & report, const Job & job, const ofxSimpleHttpResponse & r);
+
+	bool loadState(const string & statePath, const string & partPath, const Job & job, uint64_t & offset, ofxAssets::Hasher & hasher);
+	void saveState(const string & statePath, const Job & job, uint64_t offset, const ofxAssets::Hasher & hasher);
+
+	std::deque<Batch> pending;
+	std::deque<Batch> finished;
+	int numBatchesInFlight = 0;
+	bool stopping = false;
+	std::atomic<bool> canceled{false};
+
+	int timeoutSeconds = 30;
+	uint64_t stateSaveInterval = 8 * 1024 * 1024;
+	ofxAssets::BandwidthLimiter * limiter = nullptr;
+
+	std::mutex downloadMutex;
+	std::condition_variable hasWork;
+};
@@ -0,0 +1,361 @@
+//
+//  AssetScrubber.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetScrubber.h"
+#include "AssetHolder.h"
+#include "AssetHasher.h"
+#include "AssetPack.h"
+
+#if defined(TARGET_LINUX)
+	#include <sys/syscall.h>
+	#include <unistd.h>
+	#include <sched.h>
+#elif defined(TARGET_OSX)
+	#include <sys/resource.h>
+	#include <pthread/qos.h>
+#endif
+
+using namespace ofxAssets;
+
+
+AssetScrubber::~AssetScrubber(){
+	stop();
+}
+
+
+void AssetScrubber::addHolder(AssetHolder * holder){
+
+	vector<Item> newItems;
+	for(auto & d : holder->getAllAssetsInDB()){
+		if(!d.hasChecksum()) continue; //nothing to compare against (packed ones get the pack's when checked)
+		Item i;
+		i.holder = holder;
+		i.relativePath = d.relativePath;
+		i.checksum = d.checksum;
+		i.checksumType = d.checksumType;
+		i.chunks = d.chunks;
+		i.packFile = d.packFile;
+		i.packEntry = d.packEntry;
+		newItems.push_back(i);
+	}
+
+	std::unique_lock<std::mutex> lock(scrubMutex);
+	removeHolderLocked(holder); //in case we are refreshing it
+	items.insert(items.end(), newItems.begin(), newItems.end());
+}
+
+
+void AssetScrubber::removeHolder(AssetHolder * holder){
+	std::unique_lock<std::mutex> lock(scrubMutex);
+	removeHolderLocked(holder);
+}
+
+
+bool AssetScrubber::hasHolderLocked(AssetHolder * holder){
+	for(auto & i : items){
+		if(i.holder == holder) return true;
+	}
+	return false;
+}
+
+
+void AssetScrubber::removeHolderLocked(AssetHolder * holder){
+
+	size_t numBeforeNext = 0;
+	for(size_t i = 0; i < nextItem && i < items.size(); i++){
+		if(items[i].holder == holder) numBeforeNext++;
+	}
+	items.erase(std::remove_if(items.begin(), items.end(), [holder](const Item & i){ return i.holder == holder; }), items.end());
+	nextItem -= numBeforeNext;
+	corrupt.erase(std::remove_if(corrupt.begin(), corrupt.end(), [holder](const CorruptAsset & c){ return c.holder == holder; }), corrupt.end());
+}
+
+
+void AssetScrubber::start(const string & stateFile_){
+	if(isThreadRunning()){
+		ofLogError("AssetScrubber") << "Already running!";
+		return;
+	}
+	stateFile = stateFile_;
+	if(limiter.getMaxBytesPerSecond() == 0){
+		limiter.setMaxBytesPerSecond(4 * 1024 * 1024); //default budget, set it before start() to change
+	}
+	loadState();
+	startThread();
+}
+
+
+void AssetScrubber::stop(){
+	if(isThreadRunning()){
+		{ //change what the waits check for under their mutex, or the wake up can be lost
+			std::unique_lock<std::mutex> lock(scrubMutex);
+			stopThread();
+		}
+		wakeUp.notify_all();
+		waitForThread(false);
+	}
+}
+
+
+void AssetScrubber::setUnderLoad(bool underLoad_){
+	{
+		std::unique_lock<std::mutex> lock(scrubMutex);
+		underLoad = underLoad_;
+	}
+	if(!underLoad_) wakeUp.notify_all();
+}
+
+
+void AssetScrubber::update(){
+
+	std::deque<CorruptAsset> found;
+	scrubMutex.lock();
+	found.swap(corrupt); //removeHolder() drops the ones of holders that are gone
+	scrubMutex.unlock();
+
+	for(auto & c : found){
+		c.holder->markAssetAsCorrupt(c.relativePath, c.corruptChunks);
+		ofNotifyEvent(eventCorruptAsset, c, this);
+	}
+}
+
+
+void AssetScrubber::threadedFunction(){
+
+	#ifdef TARGET_WIN32
+	#elif defined(TARGET_LINUX)
+	pthread_setname_np(pthread_self(), "AssetScrubber");
+	#else
+	pthread_setname_np("AssetScrubber");
+	#endif
+
+	lowerThreadPriority();
+
+	bool resuming = lastScrubbed.size() > 0;
+	size_t numThisPass = 0;
+	float lastSave = ofGetElapsedTimef();
+
+	while(isThreadRunning()){
+
+		if(!waitWhilePaused()) break;
+
+		Item item;
+		bool haveItem = false;
+		bool passDone = false;
+		scrubMutex.lock();
+		if(resuming){ //pick up after the last one we did before the restart
+			for(size_t i = 0; i < items.size(); i++){
+				if(items[i].relativePath == lastScrubbed){
+					nextItem = i + 1;
+					break;
+				}
+			}
+			resuming = false;
+		}
+		if(nextItem >= items.size()){
+			nextItem = 0;
+			passDone = numThisPass > 0;
+		}
+		if(!passDone && items.size()){
+			item = items[nextItem++];
+			haveItem = true;
+		}
+		scrubMutex.unlock();
+
+		if(passDone){
+			numPasses++;
+			numThisPass = 0;
+			saveState();
+			std::unique_lock<std::mutex> lock(scrubMutex);
+			wakeUp.wait_for(lock, std::chrono::duration<float>(restBetweenPasses), [this]{ return !isThreadRunning(); });
+			continue;
+		}
+		if(!haveItem){ //nothing to do yet
+			std::unique_lock<std::mutex> lock(scrubMutex);
+			wakeUp.wait_for(lock, std::chrono::seconds(1), [this]{ return !isThreadRunning(); });
+			continue;
+		}
+
+		vector<size_t> corruptChunks;
+		bool aborted = false;
+		bool ok = scrub(item, corruptChunks, aborted);
+		if(aborted) break; //we'll do this one again next time
+
+		numThisPass++;
+		numScrubbed++;
+		scrubMutex.lock();
+		lastScrubbed = item.relativePath;
+		//the holder may have been removed (and deleted) while we scrubbed it: only report it if it's still ours
+		bool report = !ok && hasHolderLocked(item.holder);
+		if(report){
+			numCorrupt++;
+			CorruptAsset c;
+			c.holder = item.holder;
+			c.relativePath = item.relativePath;
+			c.corruptChunks = corruptChunks;
+			corrupt.push_back(c);
+		}
+		scrubMutex.unlock();
+		if(report){
+			ofLogWarning("AssetScrubber") << "\"" << item.relativePath << "\" is CORRUPT!";
+		}
+
+		float now = ofGetElapsedTimef();
+		if(now - lastSave > 30){
+			saveState();
+			lastSave = now;
+		}
+	}
+	saveState();
+}
+
+
+bool AssetScrubber::pace(size_t numBytes, std::function<void()> work){
+
+	if(!waitWhilePaused()) return false;
+	limiter.consume(numBytes);
+	auto t = std::chrono::steady_clock::now();
+	work();
+	//sleep enough to stay within our share of one core
+	double busy = std::chrono::duration<double>(std::chrono::steady_clock::now() - t).count();
+	if(cpuShare < 1.0f){
+		std::this_thread::sleep_for(std::chrono::duration<double>(busy * (1.0 / cpuShare - 1.0)));
+	}
+	return true;
+}
+
+
+bool AssetScrubber::scrubPacked(const Item & item, bool & aborted){
+
+	auto pack = AssetPack::get(item.packFile); //reopened if it changed on disk
+	const AssetPack::Entry * e = pack ? pack->getEntry(item.packEntry) : nullptr;
+	if(!e) return true; //missing is the AssetChecker's business
+
+	//read(), not the mapping: if the pack is truncated under us that's a failed read, not a SIGBUS
+	Hasher hasher(item.checksumType);
+	const uint64_t blockSize = 256 * 1024;
+	vector<char> block(blockSize);
+	for(uint64_t done = 0; done < e->size; done += blockSize){
+		size_t n = (size_t)std::min(blockSize, e->size - done);
+		bool intact = true;
+		bool goOn = pace(n, [&](){
+			intact = pack->read(e->offset + done, block.data(), n);
+			if(intact) hasher.update(block.data(), n);
+		});
+		if(!goOn){
+			aborted = true;
+			return true;
+		}
+		if(!intact) return false;
+	}
+	return hasher.matches(item.checksum);
+}
+
+
+bool AssetScrubber::scrub(const Item & item, vector<size_t> & corruptChunks, bool & aborted){
+
+	if(item.packFile.size()){
+		return scrubPacked(item, aborted);
+	}
+
+	std::ifstream file(ofToDataPath(item.relativePath, true), std::ios::in | std::ios::binary);
+	if(!file.is_open()) return true; //missing files are the AssetChecker's business
+
+	bool chunked = item.chunks.isValid();
+	Hasher hasher(item.checksumType);
+	ChunkVerifier verifier(item.checksumType, item.chunks);
+
+	vector<char> block(256 * 1024); //small blocks, so throttling is smooth
+	while(file){
+		bool goOn = pace(block.size(), [&](){
+			file.read(block.data(), block.size());
+			std::streamsize n = file.gcount();
+			if(n > 0){
+				if(chunked) verifier.update(block.data(), (size_t)n);
+				else hasher.update(block.data(), (size_t)n);
+			}
+		});
+		if(!goOn){
+			aborted = true;
+			return true;
+		}
+	}
+
+	if(chunked){
+		verifier.finish();
+		bool match = Hasher::checksumsMatch(verifier.getHexDigest(), item.checksum, item.checksumType);
+		if(!match) corruptChunks = verifier.getCorruptChunks();
+		return match;
+	}
+	return hasher.matches(item.checksum);
+}
+
+
+bool AssetScrubber::waitWhilePaused(){
+	std::unique_lock<std::mutex> lock(scrubMutex);
+	//timed, as ofThread can be stopped (ie waitForThread(true)) without going through stop()
+	while(underLoad && isThreadRunning()){
+		wakeUp.wait_for(lock, std::chrono::milliseconds(250));
+	}
+	return isThreadRunning();
+}
+
+
+void AssetScrubber::saveState(){
+
+	if(stateFile.empty()) return;
+	ofJson state;
+	scrubMutex.lock();
+	state["lastScrubbed"] = lastScrubbed;
+	scrubMutex.unlock();
+	state["numScrubbed"] = (uint64_t)numScrubbed;
+	state["numCorrupt"] = (uint64_t)numCorrupt;
+	state["numPasses"] = (int)numPasses;
+
+	string tmpPath = stateFile + ".tmp";
+	if(ofSavePrettyJson(tmpPath, state)){
+		try{
+			std::filesystem::rename(ofToDataPath(tmpPath, true), ofToDataPath(stateFile, true));
+		}catch(std::exception & e){
+			ofLogError("AssetScrubber") << "Can't save state \"" << stateFile << "\": " << e.what();
+		}
+	}
+}
+
+
+void AssetScrubber::loadState(){
+
+	if(stateFile.empty() || !ofFile::doesFileExist(stateFile)) return;
+	try{
+		ofJson state = ofLoadJson(stateFile);
+		lastScrubbed = state.value("lastScrubbed", string());
+		numScrubbed = state.value("numScrubbed", (uint64_t)0);
+		numCorrupt = state.value("numCorrupt", (uint64_t)0);
+		numPasses = state.value("numPasses", 0);
+	}catch(std::exception & e){
+		ofLogWarning("AssetScrubber") << "Ignoring bad state file \"" << stateFile << "\": " << e.what();
+	}
+}
+
+
+void AssetScrubber::lowerThreadPriority(){
+
+	#if defined(TARGET_LINUX)
+	//idle I/O class: only gets the disk when nobody else wants it (CFQ/BFQ schedulers)
+	const int IOPRIO_CLASS_IDLE = 3, IOPRIO_CLASS_SHIFT = 13, IOPRIO_WHO_PROCESS = 1;
+	if(syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, 0 /*this thread*/, IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT) != 0){
+		ofLogWarning("AssetScrubber") << "Can't set idle I/O priority";
+	}
+	sched_param param;
+	param.sched_priority = 0;
+	pthread_setschedparam(pthread_self(), SCHED_IDLE, &param);
+	#elif defined(TARGET_OSX)
+	setiopolicy_np(IOPOL_TYPE_DISK, IOPOL_SCOPE_THREAD, IOPOL_THROTTLE);
+	pthread_set_qos_class_self_np(QOS_CLASS_BACKGROUND, 0);
+	#elif defined(TARGET_WIN32)
+	SetThreadPriority(GetCurrentThread(), THREAD_MODE_BACKGROUND_BEGIN); //lowers I/O and memory priority too
+	#endif
+}
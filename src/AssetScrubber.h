@@ -0,0 +1,98 @@
+//
+//  AssetScrubber.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+#include "AssetHolderStructs.h"
+#include "AssetBandwidthLimiter.h"
+
+class AssetHolder;
+
+//Keeps re-verifying the checksums of your assets in the background while the app runs, to catch
+//bit rot / tampering on long running installations, without the disk and CPU spike of a full
+//AssetChecker pass. Runs in a low priority thread (idle I/O class and idle CPU scheduling where the
+//OS allows it), reads at most bytesPerSecond, and sleeps enough to only use cpuShare of one core.
+//Call setUnderLoad(true) while the app is busy (ie loading a scene) and it will pause until you
+//set it back. Where it was is saved to stateFile, so it resumes there after a restart.
+//Packed assets (see AssetPack) are scrubbed entry by entry, from the pack's mapping.
+//Corrupt assets are reported from update() (main thread): the AssetHolder gets markAssetAsCorrupt()
+//(so the next downloadMissingAssets() gets it again) and eventCorruptAsset is notified.
+
+class AssetScrubber : public ofThread{
+
+public:
+
+	struct CorruptAsset{
+		AssetHolder * holder;
+		string relativePath;
+		vector<size_t> corruptChunks;
+	};
+
+	~AssetScrubber();
+
+	//takes a snapshot of the holder's assets, call again if you add assets to it. Main thread only.
+	void addHolder(AssetHolder * holder);
+	void removeHolder(AssetHolder * holder);
+
+	void setBytesPerSecond(uint64_t bytesPerSec){limiter.setMaxBytesPerSecond(bytesPerSec);}
+	void setCpuShare(float share){cpuShare = ofClamp(share, 0.01, 1.0);}
+	void setRestBetweenPasses(float seconds){restBetweenPasses = seconds;}
+
+	void start(const string & stateFile = "logs/assetScrubber.json");
+	void stop(); //saves where we are
+
+	void setUnderLoad(bool underLoad); //pauses scrubbing while true
+	bool isUnderLoad(){return underLoad;}
+
+	void update(); //delivers corrupt assets, call from the main thread
+
+	uint64_t getNumScrubbed(){return numScrubbed;}
+	uint64_t getNumCorrupt(){return numCorrupt;}
+	int getNumPasses(){return numPasses;}
+
+	ofEvent<CorruptAsset> eventCorruptAsset;
+
+protected:
+
+	struct Item{
+		AssetHolder * holder;
+		string relativePath;
+		string checksum;
+		ofxChecksum::Type checksumType;
+		ofxAssets::ChunkManifest chunks;
+		string packFile; //packed assets are scrubbed from their pack's mapping
+		string packEntry;
+	};
+
+	void threadedFunction();
+	void removeHolderLocked(AssetHolder * holder);
+	bool hasHolderLocked(AssetHolder * holder);
+	bool scrub(const Item & item, vector<size_t> & corruptChunks, bool & aborted); //true if OK
+	bool scrubPacked(const Item & item, bool & aborted);
+	bool pace(size_t numBytes, std::function<void()> work); //throttled work on one block, false if we should stop
+	bool waitWhilePaused(); //false if we should stop
+	void saveState();
+	void loadState();
+	static void lowerThreadPriority();
+
+	vector<Item> items;
+	size_t nextItem = 0;
+	string lastScrubbed; //relative path, what we save to resume from
+	std::deque<CorruptAsset> corrupt;
+
+	string stateFile;
+	float cpuShare = 0.1;
+	float restBetweenPasses = 60;
+	std::atomic<bool> underLoad{false};
+	std::atomic<uint64_t> numScrubbed{0};
+	std::atomic<uint64_t> numCorrupt{0};
+	std::atomic<int> numPasses{0};
+
+	ofxAssets::BandwidthLimiter limiter;
+	std::mutex scrubMutex;
+	std::condition_variable wakeUp;
+};
@@ -0,0 +1,301 @@
+//
+//  AssetStoreManager.cpp
+//  ofxAssets
+//
+//
+
+#include "AssetStoreManager.h"
+#include "AssetHolder.h"
+#include "AssetResumableDownloader.h"
+#include <unordered_set>
+
+#ifndef TARGET_WIN32
+	#include <sys/stat.h>
+#endif
+
+
+void AssetStoreManager::addHolder(AssetHolder * holder){
+	if(std::find(holders.begin(), holders.end(), holder) == holders.end()){
+		holders.push_back(holder);
+	}
+}
+
+
+void AssetStoreManager::removeHolder(AssetHolder * holder){
+	holders.erase(std::remove(holders.begin(), holders.end(), holder), holders.end());
+}
+
+
+void AssetStoreManager::markUsed(const string & relativePath){
+	lastUse[relativePath] = ofGetUnixTime();
+}
+
+
+string AssetStoreManager::normalizedPath(const string & path){
+	return std::filesystem::absolute(std::filesystem::path(path)).lexically_normal().string();
+}
+
+
+bool AssetStoreManager::fillFileEntry(const string & absolutePath, FileEntry & f){
+
+	f.absolutePath = absolutePath;
+	#ifndef TARGET_WIN32
+	struct stat st;
+	if(stat(absolutePath.c_str(), &st) != 0) return false;
+	f.size = st.st_size;
+	f.fileID = ofToString((uint64_t)st.st_dev) + ":" + ofToString((uint64_t)st.st_ino);
+	f.numLinks = st.st_nlink;
+	#else
+	std::error_code ec;
+	f.size = std::filesystem::file_size(absolutePath, ec);
+	if(ec) return false;
+	f.fileID = absolutePath; //links can't be told apart, so linked files are never evicted (see numLinks)
+	f.numLinks = std::filesystem::hard_link_count(absolutePath, ec);
+	if(ec) f.numLinks = 1;
+	#endif
+	return true;
+}
+
+
+void AssetStoreManager::listDirectory(const string & dir, const vector<string> & skipDirs, vector<FileEntry> & files){
+
+	for(auto & skip : skipDirs){ //ie the shard dir is one of our asset dirs
+		if(dir.compare(0, skip.size(), skip) == 0) return;
+	}
+	std::error_code ec;
+	std::filesystem::directory_iterator it(dir, ec);
+	if(ec){
+		ofLogWarning("AssetStoreManager") << "Can't list \"" << dir << "\": " << ec.message();
+		return;
+	}
+	for(const auto & entry : it){
+		std::error_code fec;
+		if(!entry.is_regular_file(fec)) continue;
+		FileEntry f;
+		if(fillFileEntry(normalizedPath(entry.path().string()), f)){
+			files.push_back(f);
+		}
+	}
+}
+
+
+vector<AssetStoreManager::FileEntry> AssetStoreManager::listAssetDirectories(){
+
+	std::set<string> dirs;
+	for(auto h : holders){
+		dirs.insert(normalizedPath(ofToDataPath(ofFilePath::addTrailingSlash(h->getDirectoryForAssets()), true)));
+	}
+
+	//never ours to delete: shards of paged out holders, and the content store
+	vector<string> skipDirs;
+	for(auto & d : {AssetHolder::getShardDirectory(), AssetHolder::getContentStoreDirectory()}){
+		skipDirs.push_back(normalizedPath(ofToDataPath(ofFilePath::addTrailingSlash(d), true)));
+	}
+
+	vector<FileEntry> files;
+	for(auto & dir : dirs){
+		listDirectory(dir, skipDirs, files);
+	}
+	return files;
+}
+
+
+std::unordered_map<string, vector<AssetStoreManager::AssetRef>> AssetStoreManager::buildPathIndex(){
+
+	std::unordered_map<string, vector<AssetRef>> index;
+	for(auto h : holders){
+		for(auto & p : h->getAssetPaths()){ //leaves paged out holders paged out
+			AssetRef ref;
+			ref.holder = h;
+			ref.relativePath = p.relativePath;
+			ref.remote = p.remote;
+			//a packed asset's file is its pack ("pack#entry" is not a file)
+			const string & file = p.packFile.size() ? p.packFile : p.relativePath;
+			index[normalizedPath(ofToDataPath(file, true))].push_back(ref);
+		}
+	}
+	return index;
+}
+
+
+vector<string> AssetStoreManager::findOrphans(){
+
+	auto index = buildPathIndex();
+	vector<FileEntry> files = listAssetDirectories();
+	vector<string> orphans;
+
+	for(auto & f : files){
+		if(index.find(f.absolutePath) != index.end()) continue;
+
+		//an import, a pack build or a chunk repair in progress, renamed into place once complete
+		bool temporary = false;
+		for(const string & suffix : {string(".importing"), string(".building"), string(".repairing")}){
+			const string & p = f.absolutePath;
+			if(p.size() > suffix.size() && p.compare(p.size() - suffix.size(), suffix.size(), suffix) == 0) temporary = true;
+		}
+		if(temporary) continue;
+
+		//leftovers of a resumable download of an asset we still want are not orphans
+		string base;
+		for(const string & suffix : {AssetResumableDownloader::getStateFilePath(""), AssetResumableDownloader::getPartialFilePath("")}){
+			const string & p = f.absolutePath;
+			if(base.empty() && p.size() > suffix.size() && p.compare(p.size() - suffix.size(), suffix.size(), suffix) == 0){
+				base = p.substr(0, p.size() - suffix.size());
+			}
+		}
+		if(base.size() && index.find(base) != index.end()) continue;
+
+		orphans.push_back(f.absolutePath);
+	}
+	return orphans;
+}
+
+
+uint64_t AssetStoreManager::removeOrphans(){
+
+	uint64_t freed = 0;
+	vector<string> orphans = findOrphans();
+	for(auto & path : orphans){
+		std::error_code ec;
+		uint64_t size = std::filesystem::file_size(path, ec);
+		if(std::filesystem::remove(path, ec)){
+			freed += ec ? 0 : size;
+			ofLogNotice("AssetStoreManager") << "Removed orphan \"" << path << "\"";
+		}else{
+			ofLogError("AssetStoreManager") << "Can't remove orphan \"" << path << "\": " << ec.message();
+		}
+	}
+	return freed;
+}
+
+
+uint64_t AssetStoreManager::getDiskUsage(){
+	uint64_t total = 0;
+	std::unordered_set<string> counted; //hard links take the space once
+	for(auto & f : listAssetDirectories()){
+		if(counted.insert(f.fileID).second) total += f.size;
+	}
+	return total;
+}
+
+
+uint64_t AssetStoreManager::enforceDiskBudget(){
+
+	if(diskBudget == 0) return 0;
+
+	vector<FileEntry> files = listAssetDirectories();
+	uint64_t used = 0;
+	std::unordered_set<string> counted; //hard links take the space once
+	for(auto & f : files){
+		if(counted.insert(f.fileID).second) used += f.size;
+	}
+	if(used <= diskBudget) return 0;
+
+	auto index = buildPathIndex();
+
+	//with content addressing, assets are hard links to their blob: a file is only gone once all its
+	//links are, so we evict whole files (the blob and every asset linked to it)
+	std::unordered_map<string, FileEntry> blobs; //by fileID
+	if(AssetHolder::isContentAddressed()){
+		vector<FileEntry> store;
+		listDirectory(normalizedPath(ofToDataPath(ofFilePath::addTrailingSlash(AssetHolder::getContentStoreDirectory()), true)), {}, store);
+		for(auto & f : store) blobs[f.fileID] = f;
+	}
+
+	struct Candidate{
+		vector<string> paths; //all the links we know of
+		uint64_t size = 0;
+		uint64_t numLinks = 0;
+		uint64_t lastUse = 0;
+		bool evictable = true;
+		vector<AssetRef> refs;
+	};
+
+	std::unordered_map<string, Candidate> byFile; //by fileID
+	for(auto & f : files){
+		Candidate & c = byFile[f.fileID];
+		c.paths.push_back(f.absolutePath);
+		c.size = f.size;
+		c.numLinks = f.numLinks;
+
+		auto it = index.find(f.absolutePath);
+		if(it == index.end()){ //orphans are removeOrphans()'s business, and we don't evict them along
+			c.evictable = false;
+			continue;
+		}
+		for(auto & ref : it->second){
+			if(!ref.remote) c.evictable = false; //we cant get local assets back, never evict those
+			auto lu = lastUse.find(ref.relativePath);
+			if(lu != lastUse.end()) c.lastUse = std::max(c.lastUse, lu->second);
+			c.refs.push_back(ref);
+		}
+	}
+
+	vector<Candidate*> candidates;
+	for(auto & it : byFile){
+		Candidate & c = it.second;
+		auto blob = blobs.find(it.first);
+		if(blob != blobs.end()) c.paths.push_back(blob->second.absolutePath);
+		//linked from somewhere we don't manage (ie a holder we don't know): deleting ours frees nothing
+		if(c.paths.size() < c.numLinks) c.evictable = false;
+		if(c.evictable) candidates.push_back(&c);
+	}
+
+	//least recently used first; never used ones first of all, biggest first among those
+	std::sort(candidates.begin(), candidates.end(), [](const Candidate * a, const Candidate * b){
+		if(a->lastUse != b->lastUse) return a->lastUse < b->lastUse;
+		return a->size > b->size;
+	});
+
+	uint64_t freed = 0;
+	for(auto c : candidates){
+		if(used - freed <= diskBudget) break;
+		bool removedAll = true;
+		for(auto & path : c->paths){
+			std::error_code ec;
+			if(!std::filesystem::remove(path, ec) && ec){
+				ofLogError("AssetStoreManager") << "Can't evict \"" << path << "\": " << ec.message();
+				removedAll = false;
+			}
+		}
+		if(removedAll) freed += c->size;
+		for(auto & ref : c->refs){ //whatever links are gone are missing now
+			ref.holder->markAssetAsMissing(ref.relativePath);
+			lastUse.erase(ref.relativePath);
+		}
+		ofLogNotice("AssetStoreManager") << "Evicted \"" << c->paths[0] << "\"" << (c->paths.size() > 1 ? " and its links" : "")
+			<< " (" << c->size << " bytes)";
+	}
+
+	if(used - freed > diskBudget){
+		ofLogWarning("AssetStoreManager") << "Still over disk budget after evicting all we could! (" << (used - freed) << " > " << diskBudget << " bytes)";
+	}
+	return freed;
+}
+
+
+bool AssetStoreManager::saveUsageLog(const string & path){
+	ofJson json = ofJson::object();
+	for(auto & it : lastUse){
+		json[it.first] = it.second;
+	}
+	return ofSavePrettyJson(path, json);
+}
+
+
+bool AssetStoreManager::loadUsageLog(const string & path){
+
+	if(!ofFile::doesFileExist(path)) return false;
+	try{
+		ofJson json = ofLoadJson(path);
+		for(auto it = json.begin(); it != json.end(); ++it){
+			uint64_t t = it.value().get<uint64_t>();
+			uint64_t & current = lastUse[it.key()];
+			current = std::max(current, t);
+		}
+		return true;
+	}catch(std::exception & e){
+		ofLogError("AssetStoreManager") << "Can't load usage log \"" << path << "\": " << e.what();
+	}
+	return false;
+}
@@ -0,0 +1,71 @@
+//
+//  AssetStoreManager.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+#include "ofMain.h"
+
+class AssetHolder;
+
+//Keeps the asset directories of a set of AssetHolders (their "directoryForAssets") in check.
+//Finds orphans (files no registered AssetHolder references any more) and keeps the total size of
+//the directories under a disk budget by deleting the least recently used REMOTE assets. Evicted
+//assets are marked as missing on their AssetHolder, so the DownloadPolicy gets them back the next
+//time you call downloadMissingAssets(). Tell it when you use an asset with markUsed(), and
+//save/load the usage log to keep the LRU order across restarts. Not thread safe, use it from
+//the same thread you manage your AssetHolders from.
+//The shard directory and the content store (see AssetHolder) are never touched, even if they are
+//inside an asset directory. With content addressed storage on, an asset and its blob are one file:
+//it's counted once, and evicted as a whole (blob and all its links) once every asset using it can go.
+
+class AssetStoreManager{
+
+public:
+
+	void addHolder(AssetHolder * holder);
+	void removeHolder(AssetHolder * holder);
+	void clearHolders(){holders.clear();}
+
+	void setDiskBudget(uint64_t numBytes){diskBudget = numBytes;}
+	uint64_t getDiskBudget(){return diskBudget;}
+
+	void markUsed(const string & relativePath); //call when you load / show an asset
+
+	vector<string> findOrphans(); //absolute paths of the files nobody references
+	uint64_t removeOrphans(); //returns num bytes freed
+
+	uint64_t getDiskUsage(); //of all the files in all the asset directories
+	uint64_t enforceDiskBudget(); //evicts LRU remote assets until we fit, returns num bytes freed
+
+	bool saveUsageLog(const string & path);
+	bool loadUsageLog(const string & path);
+
+protected:
+
+	struct FileEntry{
+		string absolutePath;
+		uint64_t size;
+		string fileID; //same for all the hard links to a file
+		uint64_t numLinks;
+	};
+
+	struct AssetRef{
+		AssetHolder * holder;
+		string relativePath;
+		bool remote;
+	};
+
+	vector<FileEntry> listAssetDirectories();
+	static void listDirectory(const string & dir, const vector<string> & skipDirs, vector<FileEntry> & files);
+	static bool fillFileEntry(const string & absolutePath, FileEntry & f);
+	std::unordered_map<string, vector<AssetRef>> buildPathIndex(); //by normalized absolute path
+
+	static string normalizedPath(const string & path);
+
+	vector<AssetHolder*> holders;
+	std::unordered_map<string, uint64_t> lastUse; //relativePath -> unix time
+	uint64_t diskBudget = 0; //0 means no budget
+};
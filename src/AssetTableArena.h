@@ -0,0 +1,45 @@
+//
+//  AssetTableArena.h
+//  ofxAssets
+//
+//
+
+#pragma once
+
+//only built with OFX_ASSETS_ARENA defined, as it needs C++17's <memory_resource>
+#if defined(OFX_ASSETS_ARENA)
+
+#include <memory>
+#include <memory_resource>
+
+//monotonic memory for the asset tables of one AssetHolder. startOver() makes new allocations come
+//from a fresh block list and hands back the old one, so tables can be emptied by plain assignment
+//and their old blocks freed after, in one go. Not thread safe, like the tables it holds.
+namespace ofxAssets{
+
+	class TableArena : public std::pmr::memory_resource{
+
+	public:
+
+		TableArena(size_t initialBytes) : initialBytes(initialBytes),
+			blocks(new std::pmr::monotonic_buffer_resource(initialBytes)){}
+
+		//destroy what's returned once nothing points into it anymore
+		std::unique_ptr<std::pmr::monotonic_buffer_resource> startOver(){
+			auto old = std::move(blocks);
+			blocks.reset(new std::pmr::monotonic_buffer_resource(initialBytes));
+			return old;
+		}
+
+	protected:
+
+		void * do_allocate(size_t numBytes, size_t alignment) override {return blocks->allocate(numBytes, alignment);}
+		void do_deallocate(void *, size_t, size_t) override {} //all freed at once
+		bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override {return this == &other;}
+
+		size_t initialBytes;
+		std::unique_ptr<std::pmr::monotonic_buffer_resource> blocks;
+	};
+}
+
+#endif
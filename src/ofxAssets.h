@@ -9,3 +9,12 @@
 
 #include "AssetHolder.h"
 #include "AssetChecker.h"
+#include "AssetImagePreloader.h"
+#include "AssetResumableDownloader.h"
+#include "AssetStoreManager.h"
+#include "AssetAsyncCheck.h"
+#include "AssetManifestLoader.h"
+#include "AssetDownloadScheduler.h"
+#include "AssetScrubber.h"
+#include "AssetPack.h"
+#include "AssetHeaderProbe.h"